@@ -0,0 +1,2 @@
+#!/bin/bash
+./Release/local-forecast -model GEFS -skipToGribNumber 0 -maxGribIndex 240 -locationKey $1
\ No newline at end of file
@@ -20,11 +20,19 @@ pub struct WxSingle {
     pub total_snow: f64,
     pub vis: u16,
     pub wind_dir: u16,
-    pub wind_spd: u16
+    pub wind_spd: u16,
+    pub is_ensemble: bool,
+    pub precip_chance: u8,
+    pub freezing_chance: u8,
+    pub temperature_10th: i16,
+    pub temperature_90th: i16,
+    pub new_precip_10th: f64,
+    pub new_precip_90th: f64
 }
 
 impl WxSingle {
     pub fn from(wx: &rust_structs::Wx, at: usize) -> WxSingle {
+        let ensemble = wx.ensemble.as_ref();
         WxSingle { 
             dewpoint: wx.dewpoint[at],
             gust: wx.gust[at],
@@ -39,7 +47,14 @@ impl WxSingle {
             total_snow: wx.total_snow[at],
             vis: wx.vis[at],
             wind_dir: wx.wind_dir[at],
-            wind_spd: wx.wind_spd[at]
+            wind_spd: wx.wind_spd[at],
+            is_ensemble: ensemble.is_some(),
+            precip_chance: ensemble.map_or(0, |e| e.precip_chance[at]),
+            freezing_chance: ensemble.map_or(0, |e| e.freezing_chance[at]),
+            temperature_10th: ensemble.map_or(0, |e| e.temperature_10th[at]),
+            temperature_90th: ensemble.map_or(0, |e| e.temperature_90th[at]),
+            new_precip_10th: ensemble.map_or(0.0, |e| e.new_precip_10th[at]),
+            new_precip_90th: ensemble.map_or(0.0, |e| e.new_precip_90th[at])
         }
     }
 }
@@ -41,7 +41,11 @@ fn with_forecast_location<F>(forecast_c_str: *const c_char, location_c_str: *con
             f.locations.insert(location_str.clone(), Location::new(f.forecast_times.len()));
         }
 
+        let size = f.forecast_times.len();
         let map = f.locations.get_mut(&location_str).expect("To get the location data");
+
+        //Forecast times can be added on to a forecast that was loaded, so its locations grow along with them.
+        map.wx.grow_to(size);
         callback(map);
     });
 }
@@ -112,7 +116,7 @@ pub extern "C" fn forecast_repo_add_lunar_phase(forecast_c_str: *const c_char, d
 }
 
 #[unsafe(no_mangle)]
-pub extern "C" fn forecast_repo_add_location(forecast_c_str: *const c_char, location_c_str: *const c_char, location_ptr: *const c_structs::Location) {
+pub extern "C" fn forecast_repo_add_location(forecast_c_str: *const c_char, location_c_str: *const c_char, location_ptr: *const c_structs::Location, first_index: usize) {
     with_forecast_location(forecast_c_str, location_c_str, |l| {
         let location = unsafe{&*location_ptr};
 
@@ -127,7 +131,7 @@ pub extern "C" fn forecast_repo_add_location(forecast_c_str: *const c_char, loca
         }
 
         for (index, wx) in wx_slice.iter().enumerate() {
-            l.wx.add(wx, index);
+            l.wx.add(wx, first_index + index);
         }
     });
 }
@@ -20,7 +20,9 @@ pub struct Wx {
     pub total_snow: Vec<f64>,
     pub vis: Vec<u16>,
     pub wind_dir: Vec<u16>,
-    pub wind_spd: Vec<u16>
+    pub wind_spd: Vec<u16>,
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub ensemble: Option<EnsembleWx>
 }
 
 impl Wx {
@@ -39,7 +41,8 @@ impl Wx {
             total_snow: vec![0.0; size],
             vis: vec![0; size],
             wind_dir: vec![0; size],
-            wind_spd: vec![0; size]
+            wind_spd: vec![0; size],
+            ensemble: None
         }
     }
 
@@ -57,7 +60,37 @@ impl Wx {
         self.total_snow[at] = single.total_snow;
         self.vis[at] = single.vis;
         self.wind_dir[at] = single.wind_dir;
-        self.wind_spd[at] = single.wind_spd
+        self.wind_spd[at] = single.wind_spd;
+
+        if single.is_ensemble {
+            let size = self.length();
+            self.ensemble.get_or_insert_with(|| EnsembleWx::new(size)).add(single, at);
+        }
+    }
+
+    pub fn grow_to(&mut self, size: usize) {
+        if size <= self.length() {
+            return;
+        }
+
+        self.dewpoint.resize(size, 0);
+        self.gust.resize(size, 0);
+        self.lightning.resize(size, 0);
+        self.new_precip.resize(size, 0.0);
+        self.precip_rate.resize(size, 0.0);
+        self.precip_type.resize(size, PrecipitationType::NoPrecipitation);
+        self.pressure.resize(size, InHg(0.0));
+        self.temperature.resize(size, 0);
+        self.total_cloud_cover.resize(size, 0);
+        self.total_precip.resize(size, 0.0);
+        self.total_snow.resize(size, 0.0);
+        self.vis.resize(size, 0);
+        self.wind_dir.resize(size, 0);
+        self.wind_spd.resize(size, 0);
+
+        if let Some(ensemble) = &mut self.ensemble {
+            ensemble.grow_to(size);
+        }
     }
 
     pub fn length(&self) -> usize {
@@ -65,6 +98,49 @@ impl Wx {
     }
 }
 
+//Only there for ensembles. Chances are percents, and the rest are the members' 10th and 90th percentiles around the median in Wx.
+#[derive(Clone, Serialize, Deserialize)]
+#[serde(rename_all = "camelCase")]
+pub struct EnsembleWx {
+    pub precip_chance: Vec<u8>,
+    pub freezing_chance: Vec<u8>,
+    pub temperature_10th: Vec<i16>,
+    pub temperature_90th: Vec<i16>,
+    pub new_precip_10th: Vec<f64>,
+    pub new_precip_90th: Vec<f64>
+}
+
+impl EnsembleWx {
+    pub fn new(size: usize) -> Self {
+        Self {
+            precip_chance: vec![0; size],
+            freezing_chance: vec![0; size],
+            temperature_10th: vec![0; size],
+            temperature_90th: vec![0; size],
+            new_precip_10th: vec![0.0; size],
+            new_precip_90th: vec![0.0; size]
+        }
+    }
+
+    pub fn add(&mut self, single: &WxSingle, at: usize) {
+        self.precip_chance[at] = single.precip_chance;
+        self.freezing_chance[at] = single.freezing_chance;
+        self.temperature_10th[at] = single.temperature_10th;
+        self.temperature_90th[at] = single.temperature_90th;
+        self.new_precip_10th[at] = single.new_precip_10th;
+        self.new_precip_90th[at] = single.new_precip_90th
+    }
+
+    pub fn grow_to(&mut self, size: usize) {
+        self.precip_chance.resize(size, 0);
+        self.freezing_chance.resize(size, 0);
+        self.temperature_10th.resize(size, 0);
+        self.temperature_90th.resize(size, 0);
+        self.new_precip_10th.resize(size, 0.0);
+        self.new_precip_90th.resize(size, 0.0);
+    }
+}
+
 #[derive(Clone, Serialize, Deserialize)]
 #[serde(rename_all = "camelCase")]
 pub struct Location {
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+struct BoundedQueueStats {
+    size_t pushes = 0, maxDepth = 0, totalDepth = 0;
+    //Summed over every thread, so two consumers waiting a second each is two seconds.
+    std::chrono::duration<double> pushIdle = std::chrono::duration<double>::zero(), popIdle = std::chrono::duration<double>::zero();
+
+    inline double MeanDepth() const { return pushes ? totalDepth / static_cast<double>(pushes) : 0.0; }
+};
+
+//Hands work from one set of threads to another. Push blocks while the queue is full, Pop blocks while it's empty,
+//and once Close is called Pop drains whatever is left and then returns false.
+template <typename T>
+class BoundedQueue
+{
+private:
+    const size_t capacity;
+    bool closed = false;
+    std::deque<T> items;
+    std::mutex mutex;
+    std::condition_variable notFull, notEmpty;
+    BoundedQueueStats stats;
+
+public:
+    BoundedQueue(size_t capacity) : capacity(std::max<size_t>(capacity, 1)) {}
+
+    void Push(T item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto waitStart = std::chrono::steady_clock::now();
+        notFull.wait(lock, [&]() { return items.size() < capacity; });
+        stats.pushIdle += std::chrono::steady_clock::now() - waitStart;
+
+        items.push_back(std::move(item));
+        stats.pushes++;
+        stats.totalDepth += items.size();
+        stats.maxDepth = std::max(stats.maxDepth, items.size());
+
+        notEmpty.notify_one();
+    }
+
+    bool Pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto waitStart = std::chrono::steady_clock::now();
+        notEmpty.wait(lock, [&]() { return !items.empty() || closed; });
+        stats.popIdle += std::chrono::steady_clock::now() - waitStart;
+
+        if(items.empty())
+            return false;
+
+        item = std::move(items.front());
+        items.pop_front();
+
+        notFull.notify_one();
+        return true;
+    }
+
+    void Close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+    }
+
+    inline size_t GetCapacity() const { return capacity; }
+
+    BoundedQueueStats GetStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+};
\ No newline at end of file
@@ -30,7 +30,7 @@ extern "C" {
     void forecast_repo_init_forecast(const char* forecastKey);
     void forecast_repo_add_forecast_start_time(const char* forecastKey, uint64_t forecastTime);
     void forecast_repo_add_lunar_phase(const char* forecastKey, int32_t day, LunarPhase phase);
-    void forecast_repo_add_location(const char* forecastKey, const char* locationName, const Location* location);
+    void forecast_repo_add_location(const char* forecastKey, const char* locationName, const Location* location, size_t firstForecastIndex);
 
     RustForecast* forecast_repo_get_forecast(const char* forecastKey);
     void forecast_repo_free_forecast(RustForecast* forecast);
@@ -87,9 +87,9 @@ public:
         return empty;
     }
 
-    uint32_t GetForecastsFromNow(std::chrono::system_clock::time_point& now, uint32_t maxRows, function<void (std::chrono::system_clock::time_point&, const WxSingle* wx)> callback)
+    uint32_t GetForecastsFromNow(std::chrono::system_clock::time_point& now, uint32_t maxRows, seconds rowStep, function<void (std::chrono::system_clock::time_point&, const WxSingle* wx)> callback)
     {
-        return forecast->GetForecastsFromNow(now, maxRows, [&](system_clock::time_point& forecastTime, uint32_t forecastIndex)
+        return forecast->GetForecastsFromNow(now, maxRows, rowStep, [&](system_clock::time_point& forecastTime, uint32_t forecastIndex)
         {
             callback(forecastTime, &label->location.wx[forecastIndex]);
         });
@@ -105,7 +105,7 @@ public:
         auto suns = GetSunriseSunsets();
         auto sunItr = suns.begin();
 
-        GetForecastsFromNow(now, maxRows, [&](system_clock::time_point& forecastTime, const WxSingle* wx)
+        GetForecastsFromNow(now, maxRows, hours(1), [&](system_clock::time_point& forecastTime, const WxSingle* wx)
         {
             auto currentDate = GetShortDate(forecastTime);        
             if(currentDate != forecastDate)
@@ -135,9 +135,9 @@ public:
             if(wx->precipitationType == PrecipitationType::Snow)
                 summaryData.snowTotal += CalcSnowPrecip(wx, wxLast);
             else if(wx->precipitationType == PrecipitationType::FreezingRain)
-                summaryData.iceTotal += wx->newPrecipitation;
+                summaryData.iceTotal += CalcNewPrecip(wx, wxLast);
             else if(wx->precipitationType == PrecipitationType::Rain)
-                summaryData.rainTotal += wx->newPrecipitation;
+                summaryData.rainTotal += CalcNewPrecip(wx, wxLast);
 
             wxLast = wx;
         });
@@ -167,6 +167,17 @@ public:
         return 0;
     }
 
+    uint64_t GetForecastStepLength(int32_t forecastIndex)
+    {
+        if(forecastIndex < 0 || static_cast<size_t>(forecastIndex) >= forecast->forecastTimesLen || forecast->forecastTimesLen < 2)
+            return secondsInHour;
+
+        if(static_cast<size_t>(forecastIndex) + 1 < forecast->forecastTimesLen)
+            return forecast->forecastTimes[forecastIndex + 1] - forecast->forecastTimes[forecastIndex];
+
+        return forecast->forecastTimes[forecastIndex] - forecast->forecastTimes[forecastIndex - 1];
+    }
+
     vector<unique_ptr<ILocation>> GetLocations(LocationMask mask)
     {
         int32_t index = 0;
@@ -201,10 +212,11 @@ public:
         return result;
     }
 
-    uint32_t GetForecastsFromNow(std::chrono::system_clock::time_point& now, uint32_t maxRows, function<void (std::chrono::system_clock::time_point&, uint32_t forecastIndex)> callback)
+    uint32_t GetForecastsFromNow(std::chrono::system_clock::time_point& now, uint32_t maxRows, seconds rowStep, function<void (std::chrono::system_clock::time_point&, uint32_t forecastIndex)> callback)
     {
         uint32_t rowsRendered = 0, 
                 forecastIndex = 0;
+        system_clock::time_point lastRowTime;
 
         span<uint64_t> forecastTimes(forecast->forecastTimes, forecast->forecastTimesLen);
 
@@ -212,12 +224,17 @@ public:
         auto end = forecastTimes.end();
         for(auto itr = start; itr != end && rowsRendered < maxRows; itr++, forecastIndex++)
         {
+            //A step holds until the next one starts.
             auto forecastTime = system_clock::from_time_t(*itr);
-            if(forecastTime + minutes(59) + seconds(59) < now)
+            if(forecastTime + seconds(GetForecastStepLength(forecastIndex)) <= now)
+                continue;
+
+            if(rowsRendered && forecastTime - lastRowTime < rowStep)
                 continue;
 
             callback(forecastTime, forecastIndex);
 
+            lastRowTime = forecastTime;
             rowsRendered++;
         }
 
@@ -271,9 +288,9 @@ public:
         forecast_repo_add_lunar_phase(forecastKey.c_str(), currentDay, lunarPhase);
     }
 
-    void AddLocation(const string& locationKey, const Location& location)
+    void AddLocation(const string& locationKey, const Location& location, uint32_t firstForecastIndex)
     {
-        forecast_repo_add_location(forecastKey.c_str(), locationKey.c_str(), &location);
+        forecast_repo_add_location(forecastKey.c_str(), locationKey.c_str(), &location, firstForecastIndex);
     }
 
     void Save(fs::path forecastJsonPath)
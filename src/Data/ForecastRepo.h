@@ -26,6 +26,14 @@ extern "C" {
         uint16_t visibility;
         uint16_t windDirection;
         uint16_t windSpeed;
+        //The rest stay 0 unless isEnsemble. Chances are percents, and the rest are the members' 10th and 90th percentiles, the median being above.
+        bool isEnsemble;
+        uint8_t precipitationChance;
+        uint8_t freezingChance;
+        int16_t temperature10th;
+        int16_t temperature90th;
+        double newPrecipitation10th;
+        double newPrecipitation90th;
     } WxSingle;
 
     typedef struct {
@@ -72,11 +80,17 @@ inline double CalcSnowPrecip(const WxSingle* wxCurrent, const WxSingle* wxLast)
     return std::max(0.0, wxLast == nullptr ? 0 : wxCurrent->totalSnow - wxLast->totalSnow);
 }
 
+//Off the totals when there's a row before, so it covers everything since that row, however many forecast steps that was.
+inline double CalcNewPrecip(const WxSingle* wxCurrent, const WxSingle* wxLast)
+{
+    return wxLast == nullptr ? wxCurrent->newPrecipitation : std::max(0.0, wxCurrent->totalPrecipitation - wxLast->totalPrecipitation);
+}
+
 inline double CalcPrecipAmount(const WxSingle* wxCurrent, const WxSingle* wxLast)
 {
     return wxCurrent->precipitationType == static_cast<uint8_t>(PrecipitationType::Snow)
         ? CalcSnowPrecip(wxCurrent, wxLast) 
-        : wxCurrent->newPrecipitation;
+        : CalcNewPrecip(wxCurrent, wxLast);
 }
 
 class ILocation {
@@ -86,7 +100,8 @@ public:
     virtual bool IsCity() = 0;
     virtual std::span<LabeledSun> GetSunriseSunsets() = 0;
     virtual const WxSingle& GetForecastAt(uint32_t forecastIndex) = 0;
-    virtual uint32_t GetForecastsFromNow(std::chrono::system_clock::time_point& now, uint32_t maxRows, std::function<void (std::chrono::system_clock::time_point&, const WxSingle* wx)> callback) = 0;
+    //See IForecast::GetForecastsFromNow.
+    virtual uint32_t GetForecastsFromNow(std::chrono::system_clock::time_point& now, uint32_t maxRows, std::chrono::seconds rowStep, std::function<void (std::chrono::system_clock::time_point&, const WxSingle* wx)> callback) = 0;
     virtual void CollectSummaryData(SummaryData& summaryData, uint32_t maxRows) = 0;
     virtual ~ILocation(){};
 };
@@ -102,9 +117,13 @@ public:
     virtual void SetNow(uint64_t now) = 0;
     virtual uint64_t GetNow() = 0;
     virtual uint64_t GetForecastTime(int32_t forecastIndex) = 0;
+    //Seconds until the next forecast time, or since the one before it for the last. An hour when there's only the one.
+    virtual uint64_t GetForecastStepLength(int32_t forecastIndex) = 0;
     virtual std::vector<std::unique_ptr<ILocation>> GetLocations(LocationMask mask) = 0;
     virtual std::vector<std::unique_ptr<ILocation>> GetSortedPlaceLocations() = 0;
-    virtual uint32_t GetForecastsFromNow(std::chrono::system_clock::time_point& now, uint32_t maxRows, std::function<void (std::chrono::system_clock::time_point&, uint32_t forecastIndex)> callback) = 0;
+    //Every forecast time whose step hasn't ended by now, up to maxRows of them. Each row after the first is at least rowStep after the one before,
+    //so sub-hourly steps can still be read an hour at a time. 0 gives every step.
+    virtual uint32_t GetForecastsFromNow(std::chrono::system_clock::time_point& now, uint32_t maxRows, std::chrono::seconds rowStep, std::function<void (std::chrono::system_clock::time_point&, uint32_t forecastIndex)> callback) = 0;
     virtual LunarPhase GetLunarPhaseForDay(int32_t day) = 0;
     virtual ~IForecast(){};
 };
@@ -113,7 +132,8 @@ class IForecastRepo {
 public:
     virtual void AddForecastStartTime(std::chrono::system_clock::time_point startTime) = 0;
     virtual void AddLunarPhase(int32_t currentDay, LunarPhase lunarPhase) = 0;
-    virtual void AddLocation(const std::string& locationKey, const Location& location) = 0;
+    //location's wx goes in from firstForecastIndex on, so hours can be added on to the end of a location that's already there.
+    virtual void AddLocation(const std::string& locationKey, const Location& location, uint32_t firstForecastIndex = 0) = 0;
     virtual void Save(std::filesystem::path forecastJsonPath) = 0;
     virtual IForecast* GetForecast() = 0;
     virtual ~IForecastRepo(){};
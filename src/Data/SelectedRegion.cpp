@@ -30,9 +30,17 @@ void GetGeoBoundsFromJsonValue(WeatherModel wxModel, GeoBounds& geoBounds, Json:
         geoBounds.rightLon += 0.5,
         geoBounds.bottomLat -= 0.5;
     }
+    else if(wxModel == WeatherModel::GEFS)
+    {
+        geoBounds.leftLon -= 1.0,
+        geoBounds.topLat += 1.0,
+        geoBounds.rightLon += 1.0,
+        geoBounds.bottomLat -= 1.0;
+    }
 }
 
 SelectedRegion::SelectedRegion(WeatherModel wxModel, string key)
+    : key(key)
 {
     Json::Value settings;
 
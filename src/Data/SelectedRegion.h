@@ -37,7 +37,7 @@ struct GeoBounds {
 
 class SelectedRegion {
 private:
-    std::string mapBackground;
+    std::string key, mapBackground;
     std::string outputFolder;
     GeoCoord regionalCoord;
     GeoBounds regionBoundsWithOverflow, renderableRegionBounds, forecastAreaBounds;
@@ -50,6 +50,7 @@ public:
     void RenderRegionalForecastPaths(std::filesystem::path& pathToJson, std::filesystem::path& pathToPng) const;
     void RenderRegionalForecast(const std::filesystem::path& pathToJson, const std::filesystem::path& pathToPng) const;
 
+    inline const std::string& GetKey() const { return key; }
     inline const std::string& GetMapBackgroundFileName() const {return mapBackground; }
     inline const GeoCoord& GetRegionalCoord() const { return regionalCoord; }
     inline const GeoBounds& GetRegionBoundsWithOverflow() const { return regionBoundsWithOverflow; }
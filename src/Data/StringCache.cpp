@@ -1,13 +1,26 @@
 #include "StringCache.h"
 
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 
 using namespace std;
 
 static unordered_map<string, const char*> internedStrings;
+static shared_mutex internedStringsMutex;
 
 const char* GetCachedString(const char* str)
 {
+    {
+        shared_lock<shared_mutex> readLock(internedStringsMutex);
+        auto itr = internedStrings.find(str);
+        if(itr != internedStrings.end())
+            return itr->second;
+    }
+
+    unique_lock<shared_mutex> writeLock(internedStringsMutex);
+    //Another thread may have interned the same string between the two locks.
     auto itr = internedStrings.find(str);
     if(itr != internedStrings.end())
         return itr->second;
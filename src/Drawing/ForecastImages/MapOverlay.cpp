@@ -5,6 +5,7 @@
 
 
 #include <algorithm>
+#include <cstdio>
 #include <functional>
 #include <iostream>
 #include <unordered_set>
@@ -118,6 +119,24 @@ class MapOverlay : public IMapOverlay
             bitmapContext->Save(fileName);
         }
 
+        void SavePixels(const char* fileName)
+        {
+            auto f = fopen(fileName, "wb");
+            if(!f || fwrite(bitmapContext->GetPointer({0, 0}), 4 * width, height, f) != static_cast<size_t>(height))
+                ERR_OUT("Unable to save overlay pixels to " << fileName);
+
+            fclose(f);
+        }
+
+        void LoadPixels(const char* fileName)
+        {
+            auto f = fopen(fileName, "rb");
+            if(!f || fread(bitmapContext->GetPointer({0, 0}), 4 * width, height, f) != static_cast<size_t>(height))
+                ERR_OUT("Unable to load overlay pixels from " << fileName);
+
+            fclose(f);
+        }
+
         virtual ~MapOverlay() = default;
 };
 
@@ -16,6 +16,11 @@ public:
     virtual std::shared_ptr<IBitmapContext> GetBitmapContext() = 0;
     virtual void Save(const char* fileName) = 0;
     inline void Save(std::string fileName) { Save(fileName.c_str()); }
+    //The pixels just as they are, for an overlay that's put away partly drawn and picked back up later, which a PNG can't be drawn back into.
+    virtual void SavePixels(const char* fileName) = 0;
+    inline void SavePixels(std::string fileName) { SavePixels(fileName.c_str()); }
+    virtual void LoadPixels(const char* fileName) = 0;
+    inline void LoadPixels(std::string fileName) { LoadPixels(fileName.c_str()); }
     virtual ~IMapOverlay() = default;
 };
 
@@ -209,7 +209,7 @@ DSSize RenderHourlyForecastForLocation(bool isMeasurePass, unique_ptr<IDrawServi
     const WxSingle* wxLast = nullptr;
     auto suns = location->GetSunriseSunsets();
     auto sunItr = suns.begin();
-    auto rowsRendered = location->GetForecastsFromNow(now, maxRows, [&](system_clock::time_point& forecastTime, const WxSingle* wxCurrent)
+    auto rowsRendered = location->GetForecastsFromNow(now, maxRows, hours(1), [&](system_clock::time_point& forecastTime, const WxSingle* wxCurrent)
     {
         if((system_clock::to_time_t(forecastTime) + timezone) % 86400 == 0)
             dayCounter++;
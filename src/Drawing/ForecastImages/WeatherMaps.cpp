@@ -24,6 +24,9 @@ private:
     fs::path forecastDataOutputDir;
     shared_ptr<IImage> mapBackground;
     GeographicCalcs& geoCalcs;
+    int32_t tiledFrames = 0, setAsideFrames = 0;
+    //Which of the frames drawn a tile or a few hours at a time were interpolated, since the GribData they came from is gone by the time they're finished.
+    vector<uint8_t> interpolatedFrames;
 
 void SetupForecastImageTextContext(IDrawTextContext* textContext)
 {
@@ -33,12 +36,34 @@ void SetupForecastImageTextContext(IDrawTextContext* textContext)
     textContext->SetTextStrokeColorWithThickness(PredefinedColors::black, 3.0);
 }
 
+static inline string MapLabel(const char* name, bool interpolated)
+{
+    return interpolated ? string(name) + " (interpolated)" : string(name);
+}
+
+static inline fs::path SetAsideOverlayPath(const fs::path& forecastDataOutputDir, const char* name, int32_t forecastIndex, const char* extension = ".png")
+{
+    return forecastDataOutputDir / (string("overlay-") + name + "-" + ToStringWithPad(3, '0', forecastIndex) + extension);
+}
+
+//A frame that's only been drawn as far as the tiles so far, as its raw pixels, so the next tile can be drawn on top of it.
+static inline fs::path TiledOverlayPath(const fs::path& forecastDataOutputDir, const char* name, int32_t forecastIndex)
+{
+    return SetAsideOverlayPath(forecastDataOutputDir, name, forecastIndex, ".rgba");
+}
+
 void FinishImage(const char* label, int32_t forecastIndex, const vector<unique_ptr<ILocation>>& locations, unique_ptr<IMapOverlay>& mapOverlay, string fileName)
+{
+    FinishImage(label, forecastIndex, locations, mapOverlay->GetSize(), shared_ptr<IDrawService>(mapOverlay->GetBitmapContext()->ToDrawService()), fileName);
+}
+
+//overlay is either a draw service or the path to one saved off earlier.
+template <typename Overlay>
+void FinishImage(const char* label, int32_t forecastIndex, const vector<unique_ptr<ILocation>>& locations, DSInt32Size mapSize, Overlay overlay, string fileName)
 {
     const int32_t marginOffset = 32;
 
     //Setup the Base Map, the Forecast Overlay, and the location forecasts.
-    auto mapSize = mapOverlay->GetSize();
     auto bgSize = mapBackground->GetSize();
     auto locationDrawService = shared_ptr<IDrawService>(AllocDrawService(mapSize.width, mapSize.height));
     locationDrawService->SetDropShadow({4.0, -4.0}, 0.0);
@@ -70,9 +95,7 @@ void FinishImage(const char* label, int32_t forecastIndex, const vector<unique_p
     }
 
     drawService = unique_ptr<IDrawService>(AllocDrawService(defaultImageWidth, defaultImageHeight));
-    auto mapOverlayDraw = shared_ptr<IDrawService>(mapOverlay->GetBitmapContext()->ToDrawService());
-    
-    drawService->DrawCroppedImage(mapOverlayDraw, croppingBounds, targetBounds, 0.75);
+    drawService->DrawCroppedImage(overlay, croppingBounds, targetBounds, 0.75);
     drawService->DrawCroppedImage(locationDrawService, croppingBounds, targetBounds);
 
     //Add the final text to the rendered image;
@@ -103,6 +126,74 @@ void FinishImage(const char* label, int32_t forecastIndex, const vector<unique_p
     drawService->Save(forecastDataOutputDir / fileName);
 }
 
+//Only the columns the maps use are read, and each quad's corners are just indexes into them.
+void DrawQuads(GribData* gribData, int32_t forecastIndex, unique_ptr<IMapOverlay>& temperatureImg, unique_ptr<IMapOverlay>& precipImg)
+{
+    auto temperatures = gribData->GetField(GribField::TemperatureField, forecastIndex);
+    auto precipitationRates = gribData->GetField(GribField::PrecipitationRateField, forecastIndex);
+    auto types = gribData->GetTypes(forecastIndex);
+
+    auto temperatureAt = [&](int32_t point) { return temperatures.empty() ? 0.0 : temperatures[point]; };
+    auto precipColorAt = [&](int32_t point) {
+        auto type = types.empty() ? PrecipitationType::NoPrecipitation : types[point];
+        auto rate = precipitationRates.empty() ? 0.0 : precipitationRates[point];
+        return type == PrecipitationType::NoPrecipitation ? PredefinedColors::transparent : ColorFromPrecipitation(type, ScaledValueForTypeAndTemp(type, rate, temperatureAt(point)));
+    };
+
+    for(auto quad : gribData->GetQuads())
+    {
+        MapOverlayPixel topLeft = {
+            .pt = geoCalcs.FindXY(quad.topLeft.coord),
+            .px = ColorFromDegrees(temperatureAt(quad.topLeft.point))
+        },
+        topRight = {
+            .pt = geoCalcs.FindXY(quad.topRight.coord),
+            .px = ColorFromDegrees(temperatureAt(quad.topRight.point))
+        },
+        bottomLeft = {
+            .pt = geoCalcs.FindXY(quad.bottomLeft.coord),
+            .px = ColorFromDegrees(temperatureAt(quad.bottomLeft.point))
+        },
+        bottomRight = {
+            .pt = geoCalcs.FindXY(quad.bottomRight.coord),
+            .px = ColorFromDegrees(temperatureAt(quad.bottomRight.point))
+        }; 
+
+        temperatureImg->InterpolateFill(topLeft, topRight, bottomLeft, bottomRight);
+
+        #define SET_PRECIP_PX(var) var.px = precipColorAt(quad.var.point)
+        SET_PRECIP_PX(topLeft);
+        SET_PRECIP_PX(topRight);
+        SET_PRECIP_PX(bottomLeft);
+        SET_PRECIP_PX(bottomRight);
+        #undef SET_PRECIP_PX
+
+        precipImg->InterpolateFill(topLeft, topRight, bottomLeft, bottomRight);
+    }
+}
+
+static inline double ChanceAt(GribData* gribData, int32_t point, int32_t forecastIndex)
+{
+    auto stats = gribData->GetEnsembleStats(point, forecastIndex);
+    return stats ? stats->precipitationChance : 0;
+}
+
+//Only for an ensemble, the share of its members with measurable precipitation.
+void DrawChanceQuads(GribData* gribData, int32_t forecastIndex, unique_ptr<IMapOverlay>& chanceImg)
+{
+    for(auto quad : gribData->GetQuads())
+    {
+        #define CHANCE_PX(var) MapOverlayPixel var = { .pt = geoCalcs.FindXY(quad.var.coord), .px = ColorFromChance(ChanceAt(gribData, quad.var.point, forecastIndex)) }
+        CHANCE_PX(topLeft);
+        CHANCE_PX(topRight);
+        CHANCE_PX(bottomLeft);
+        CHANCE_PX(bottomRight);
+        #undef CHANCE_PX
+
+        chanceImg->InterpolateFill(topLeft, topRight, bottomLeft, bottomRight);
+    }
+}
+
 public:
     WeatherMaps(const unique_ptr<IForecast>& forecast, const unique_ptr<GribData>& gribData, GeographicCalcs& geoCalcs, const string& mapBackgroundFile)
         : forecast(forecast), gribData(gribData), geoCalcs(geoCalcs)
@@ -110,7 +201,7 @@ public:
         mapBackground = shared_ptr<IImage>(AllocImage(fs::path("media") / string("images") / mapBackgroundFile));
     }
 
-   void GenerateForecastMaps(fs::path forecastDataOutputDir)
+   void GenerateForecastMaps(fs::path forecastDataOutputDir, int32_t firstForecastIndex)
    {   
         cout << "Rendering Forecast Maps..." << endl;
 
@@ -120,48 +211,125 @@ public:
         auto locations = forecast->GetLocations(LocationMask::Cities);
 
         #pragma omp parallel for
-        for(auto forecastIndex = 0; forecastIndex < gribData->GetNumberOfFiles(); forecastIndex++)
+        for(auto forecastIndex = firstForecastIndex; forecastIndex < gribData->GetNumberOfFiles(); forecastIndex++)
         {
-            auto forecastQuads = gribData->GetQuadIteratorForFileIndex(forecastIndex);
             auto imgSuffix = ToStringWithPad(3, '0', forecastIndex);
             string temperatureFileName = "temperature-" + imgSuffix + ".png",
                    precipFileName = "precip-" + imgSuffix + ".png";
 
             auto temperatureImg = unique_ptr<IMapOverlay>(AllocMapOverlay(overlayBounds.width, overlayBounds.height));
             auto precipImg = unique_ptr<IMapOverlay>(AllocMapOverlay(overlayBounds.width, overlayBounds.height));
-            for(auto& quad : forecastQuads)
+            DrawQuads(gribData.get(), forecastIndex, temperatureImg, precipImg);
+
+            auto interpolated = gribData->IsInterpolated(forecastIndex);
+            FinishImage(MapLabel("Temperature", interpolated).c_str(), forecastIndex, locations, temperatureImg, temperatureFileName);
+            FinishImage(MapLabel("Precipitation", interpolated).c_str(), forecastIndex, locations, precipImg, precipFileName);
+
+            if(!gribData->IsEnsemble())
+                continue;
+
+            auto chanceImg = unique_ptr<IMapOverlay>(AllocMapOverlay(overlayBounds.width, overlayBounds.height));
+            DrawChanceQuads(gribData.get(), forecastIndex, chanceImg);
+            FinishImage(MapLabel("Chance of Precipitation", interpolated).c_str(), forecastIndex, locations, chanceImg, "precip-chance-" + imgSuffix + ".png");
+        }
+    }
+
+    void DrawTile(const unique_ptr<GribData>& tile, fs::path forecastDataOutputDir)
+    {
+        auto overlayBounds = geoCalcs.Bounds();
+
+        interpolatedFrames.resize(max<size_t>(interpolatedFrames.size(), tile->GetNumberOfFiles()), false);
+        for(auto forecastIndex = 0; forecastIndex < static_cast<int32_t>(tile->GetNumberOfFiles()); forecastIndex++)
+            interpolatedFrames[forecastIndex] = tile->IsInterpolated(forecastIndex);
+
+        //Every quad belongs to exactly one tile, so once they're all in, the overlays are the same as if the region was drawn at once.
+        //Only the frames being drawn on are held, one per thread, and go back on disk in between tiles.
+        #pragma omp parallel for
+        for(auto forecastIndex = 0; forecastIndex < static_cast<int32_t>(tile->GetNumberOfFiles()); forecastIndex++)
+        {
+            auto temperaturePath = TiledOverlayPath(forecastDataOutputDir, "temperature", forecastIndex);
+            auto precipPath = TiledOverlayPath(forecastDataOutputDir, "precip", forecastIndex);
+            auto temperatureImg = unique_ptr<IMapOverlay>(AllocMapOverlay(overlayBounds.width, overlayBounds.height));
+            auto precipImg = unique_ptr<IMapOverlay>(AllocMapOverlay(overlayBounds.width, overlayBounds.height));
+            if(forecastIndex < tiledFrames)
             {
-                MapOverlayPixel topLeft = {
-                    .pt = geoCalcs.FindXY(quad.topLeft.coord),
-                    .px = ColorFromDegrees(quad.topLeft.wx.temperature)
-                },
-                topRight = {
-                    .pt = geoCalcs.FindXY(quad.topRight.coord),
-                    .px = ColorFromDegrees(quad.topRight.wx.temperature)
-                },
-                bottomLeft = {
-                    .pt = geoCalcs.FindXY(quad.bottomLeft.coord),
-                    .px = ColorFromDegrees(quad.bottomLeft.wx.temperature)
-                },
-                bottomRight = {
-                    .pt = geoCalcs.FindXY(quad.bottomRight.coord),
-                    .px = ColorFromDegrees(quad.bottomRight.wx.temperature)
-                }; 
-
-                temperatureImg->InterpolateFill(topLeft, topRight, bottomLeft, bottomRight);
-
-                #define SET_PRECIP_PX(var) var.px = quad.var.wx.type == PrecipitationType::NoPrecipitation ? PredefinedColors::transparent : ColorFromPrecipitation(quad.var.wx.type, ScaledValueForTypeAndTemp(quad.var.wx.type, quad.var.wx.precipitationRate, quad.var.wx.temperature))
-                SET_PRECIP_PX(topLeft);
-                SET_PRECIP_PX(topRight);
-                SET_PRECIP_PX(bottomLeft);
-                SET_PRECIP_PX(bottomRight);
-                #undef SET_PRECIP_PX
-
-                precipImg->InterpolateFill(topLeft, topRight, bottomLeft, bottomRight);
+                temperatureImg->LoadPixels(temperaturePath);
+                precipImg->LoadPixels(precipPath);
             }
 
-            FinishImage("Temperature", forecastIndex, locations, temperatureImg, temperatureFileName);
-            FinishImage("Precipitation", forecastIndex, locations, precipImg, precipFileName);
+            DrawQuads(tile.get(), forecastIndex, temperatureImg, precipImg);
+
+            temperatureImg->SavePixels(temperaturePath);
+            precipImg->SavePixels(precipPath);
+        }
+
+        tiledFrames = max<int32_t>(tiledFrames, tile->GetNumberOfFiles());
+    }
+
+    void DrawHours(const unique_ptr<GribData>& hours, int32_t firstForecastIndex, fs::path forecastDataOutputDir)
+    {
+        auto overlayBounds = geoCalcs.Bounds();
+
+        interpolatedFrames.resize(max<size_t>(interpolatedFrames.size(), firstForecastIndex + hours->GetNumberOfFiles()), false);
+        for(auto fileIndex = 0; fileIndex < static_cast<int32_t>(hours->GetNumberOfFiles()); fileIndex++)
+            interpolatedFrames[firstForecastIndex + fileIndex] = hours->IsInterpolated(fileIndex);
+
+        #pragma omp parallel for
+        for(auto fileIndex = 0; fileIndex < static_cast<int32_t>(hours->GetNumberOfFiles()); fileIndex++)
+        {
+            auto forecastIndex = firstForecastIndex + fileIndex;
+            auto temperatureImg = unique_ptr<IMapOverlay>(AllocMapOverlay(overlayBounds.width, overlayBounds.height));
+            auto precipImg = unique_ptr<IMapOverlay>(AllocMapOverlay(overlayBounds.width, overlayBounds.height));
+            DrawQuads(hours.get(), fileIndex, temperatureImg, precipImg);
+
+            temperatureImg->Save(SetAsideOverlayPath(forecastDataOutputDir, "temperature", forecastIndex));
+            precipImg->Save(SetAsideOverlayPath(forecastDataOutputDir, "precip", forecastIndex));
+        }
+
+        setAsideFrames = max<int32_t>(setAsideFrames, firstForecastIndex + hours->GetNumberOfFiles());
+    }
+
+    void FinishForecastMaps(fs::path forecastDataOutputDir)
+    {
+        cout << "Rendering Forecast Maps..." << endl;
+
+        this->forecastDataOutputDir = forecastDataOutputDir;
+        auto locations = forecast->GetLocations(LocationMask::Cities);
+        auto overlayBounds = geoCalcs.Bounds();
+        auto frames = max<int32_t>(tiledFrames, setAsideFrames);
+
+        #pragma omp parallel for
+        for(auto forecastIndex = 0; forecastIndex < frames; forecastIndex++)
+        {
+            auto imgSuffix = ToStringWithPad(3, '0', forecastIndex);
+            auto interpolated = static_cast<size_t>(forecastIndex) < interpolatedFrames.size() && interpolatedFrames[forecastIndex];
+            auto temperatureLabel = MapLabel("Temperature", interpolated), 
+                 precipLabel = MapLabel("Precipitation", interpolated);
+            if(forecastIndex < tiledFrames)
+            {
+                auto temperaturePath = TiledOverlayPath(forecastDataOutputDir, "temperature", forecastIndex);
+                auto precipPath = TiledOverlayPath(forecastDataOutputDir, "precip", forecastIndex);
+                auto temperatureImg = unique_ptr<IMapOverlay>(AllocMapOverlay(overlayBounds.width, overlayBounds.height));
+                auto precipImg = unique_ptr<IMapOverlay>(AllocMapOverlay(overlayBounds.width, overlayBounds.height));
+                temperatureImg->LoadPixels(temperaturePath);
+                precipImg->LoadPixels(precipPath);
+
+                FinishImage(temperatureLabel.c_str(), forecastIndex, locations, temperatureImg, "temperature-" + imgSuffix + ".png");
+                FinishImage(precipLabel.c_str(), forecastIndex, locations, precipImg, "precip-" + imgSuffix + ".png");
+
+                fs::remove(temperaturePath);
+                fs::remove(precipPath);
+                continue;
+            }
+
+            auto temperaturePath = SetAsideOverlayPath(forecastDataOutputDir, "temperature", forecastIndex);
+            auto precipPath = SetAsideOverlayPath(forecastDataOutputDir, "precip", forecastIndex);
+            DSInt32Size mapSize = { overlayBounds.width, overlayBounds.height };
+            FinishImage(temperatureLabel.c_str(), forecastIndex, locations, mapSize, temperaturePath.string(), "temperature-" + imgSuffix + ".png");
+            FinishImage(precipLabel.c_str(), forecastIndex, locations, mapSize, precipPath.string(), "precip-" + imgSuffix + ".png");
+
+            fs::remove(temperaturePath);
+            fs::remove(precipPath);
         }
     }
 
@@ -8,7 +8,13 @@
 class IWeatherMaps
 {
 public:
-    virtual void GenerateForecastMaps(std::filesystem::path forecastDataOutputDir) = 0;
+    //Frames before firstForecastIndex are left as they are, for when hours were added on to a forecast that was already drawn.
+    virtual void GenerateForecastMaps(std::filesystem::path forecastDataOutputDir, int32_t firstForecastIndex = 0) = 0;
+    //For tiled ingest. Each tile's quads are drawn on top of every hour's overlay so far, which is kept in forecastDataOutputDir in between tiles.
+    virtual void DrawTile(const std::unique_ptr<GribData>& tile, std::filesystem::path forecastDataOutputDir) = 0;
+    //For streamed ingest. Each hour's overlays are drawn as it goes by and set aside in forecastDataOutputDir, for FinishForecastMaps to pick back up.
+    virtual void DrawHours(const std::unique_ptr<GribData>& hours, int32_t firstForecastIndex, std::filesystem::path forecastDataOutputDir) = 0;
+    virtual void FinishForecastMaps(std::filesystem::path forecastDataOutputDir) = 0;
     virtual ~IWeatherMaps() = default;
 };
 
@@ -105,4 +105,20 @@ DSColor ColorFromWind(double velocity)
     WIND_COLOR( 5,  95, 231, 45);
 
     return {42, 247, 45, 255};
+}
+
+#define CHANCE_COLOR(c, r, g, b) if(chance >= c) return {r, g, b, 255}
+DSColor ColorFromChance(double chance)
+{
+    CHANCE_COLOR(0.9,   0,  60,   0);
+    CHANCE_COLOR(0.8,   0, 100,   0);
+    CHANCE_COLOR(0.7,   0, 130,   0);
+    CHANCE_COLOR(0.6,   0, 160,   0);
+    CHANCE_COLOR(0.5,  40, 185,  40);
+    CHANCE_COLOR(0.4,  80, 205,  80);
+    CHANCE_COLOR(0.3, 120, 220, 120);
+    CHANCE_COLOR(0.2, 160, 235, 160);
+    CHANCE_COLOR(0.1, 200, 245, 200);
+
+    return {0, 0, 0, 0};
 }
\ No newline at end of file
@@ -5,4 +5,6 @@
 
 DSColor ColorFromDegrees(double farenheight);
 DSColor ColorFromPrecipitation(PrecipitationType precipitationType, double rate);
-DSColor ColorFromWind(double velocity);
\ No newline at end of file
+DSColor ColorFromWind(double velocity);
+//chance is from 0 to 1. Transparent below 10%.
+DSColor ColorFromChance(double chance);
\ No newline at end of file
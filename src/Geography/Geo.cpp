@@ -70,10 +70,10 @@ private:
   GeographicCalcs& geoCalcs;
 
 public:
-    GeoPointSet(const vector<GeoCoord>& geoCoords, GeographicCalcs& geoCalcs) 
-        : geoCoords(geoCoords), geoCalcs(geoCalcs)
+    GeoPointSet(span<const GeoCoord> geoCoords, GeographicCalcs& geoCalcs) 
+        : geoCoords(geoCoords.begin(), geoCoords.end()), geoCalcs(geoCalcs)
     {
-        pointSet.Initialize(geoCoords, distanceFunctor);        
+        pointSet.Initialize(this->geoCoords, distanceFunctor);        
     }
 
     void GetBoundingBox(const Location& location, GeoCoordPoint resultIndexes[4])
@@ -95,7 +95,8 @@ public:
                     .lon = geoCoord.lon
                 },
                 .x = pt.x, 
-                .y = pt.y
+                .y = pt.y,
+                .id = i
             });
         }
 
@@ -119,7 +120,7 @@ public:
     }
 };
 
-IGeoPointSet* AllocGeoPointSet(const vector<GeoCoord>& geoCoords, GeographicCalcs& geoCalcs)
+IGeoPointSet* AllocGeoPointSet(span<const GeoCoord> geoCoords, GeographicCalcs& geoCalcs)
 {
     return new GeoPointSet(geoCoords, geoCalcs);
 }
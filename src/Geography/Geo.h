@@ -3,10 +3,13 @@
 #include "Calcs.h"
 #include "Data/SelectedRegion.h"
 
+#include <span>
 #include <vector>
 
 struct GeoCoordPoint : GeoCoord {
     double x, y;
+    //Its index in the coords the IGeoPointSet was made from, which for GribData is the point id.
+    int32_t id;
 };
 
 class GeographicCalcs {
@@ -30,6 +33,6 @@ public:
   virtual ~IGeoPointSet() = default;
 };
 
-IGeoPointSet* AllocGeoPointSet(const std::vector<GeoCoord>& geoCoords, GeographicCalcs& geoCalcs);
+IGeoPointSet* AllocGeoPointSet(std::span<const GeoCoord> geoCoords, GeographicCalcs& geoCalcs);
 
 double CalcDistanceInMetersBetweenCoords(GeoCoord first, GeoCoord second);
\ No newline at end of file
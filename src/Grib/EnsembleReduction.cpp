@@ -0,0 +1,94 @@
+#include "EnsembleReduction.h"
+
+#include <algorithm>
+#include <omp.h>
+
+using namespace std;
+
+static const double ensemblePercentiles[EnsemblePercentileCount] = { 0.1, 0.5, 0.9 };
+static const double measurablePrecipitation = 0.01, freezing = 32.0;
+
+//Linear between the two members on either side of it. sorted can't be empty.
+inline double Percentile(const vector<double>& sorted, double percentile)
+{
+    auto position = percentile * (sorted.size() - 1);
+    auto below = static_cast<size_t>(position);
+    auto above = min(below + 1, sorted.size() - 1);
+    return sorted[below] + (sorted[above] - sorted[below]) * (position - below);
+}
+
+inline void FillPercentiles(const vector<double>& sorted, float (&percentiles)[EnsemblePercentileCount])
+{
+    for(auto p = 0; p < EnsemblePercentileCount; p++)
+        percentiles[p] = static_cast<float>(Percentile(sorted, ensemblePercentiles[p]));
+}
+
+void ReduceEnsembleHour(const vector<RawForecastHour>& members, size_t numberOfPoints, RawForecastHour& reduced, vector<EnsembleStats>& stats)
+{
+    reduced = {};
+    stats.assign(numberOfPoints, {});
+    if(members.empty())
+        return;
+
+    //A field only some of the members have is left out, rather than have the rest count as zeros.
+    vector<GribField> fields;
+    for(auto field = 0; field < GribFieldCount; field++)
+    {
+        if(IsCategoricalGribField(static_cast<GribField>(field)))
+            continue;
+
+        if(all_of(members.begin(), members.end(), [&](const RawForecastHour& member) { return !member.fields[field].empty(); }))
+        {
+            fields.push_back(static_cast<GribField>(field));
+            reduced.fields[field].resize(numberOfPoints);
+        }
+    }
+
+    copy(begin(members.front().stepStarts), end(members.front().stepStarts), begin(reduced.stepStarts));
+
+    auto hasTypes = all_of(members.begin(), members.end(), [](const RawForecastHour& member) { return !member.precipitationTypes.empty(); });
+    if(hasTypes)
+        reduced.precipitationTypes.resize(numberOfPoints);
+
+    auto memberCount = static_cast<float>(members.size());
+
+    #pragma omp parallel
+    {
+        vector<double> values(members.size());
+
+        #pragma omp for schedule(static)
+        for(size_t point = 0; point < numberOfPoints; point++)
+        {
+            auto& pointStats = stats[point];
+            for(auto field : fields)
+            {
+                for(size_t member = 0; member < members.size(); member++)
+                    values[member] = members[member].fields[field][point];
+
+                sort(values.begin(), values.end());
+                reduced.fields[field][point] = Percentile(values, ensemblePercentiles[FiftiethPercentile]);
+
+                if(field == GribField::TemperatureField)
+                {
+                    FillPercentiles(values, pointStats.temperature);
+                    pointStats.freezingChance = (lower_bound(values.begin(), values.end(), freezing) - values.begin()) / memberCount;
+                }
+                else if(field == GribField::NewPrecipitationField)
+                {
+                    FillPercentiles(values, pointStats.newPrecipitation);
+                    pointStats.precipitationChance = (values.end() - upper_bound(values.begin(), values.end(), measurablePrecipitation)) / memberCount;
+                }
+            }
+
+            if(!hasTypes)
+                continue;
+
+            //Every combination of the three types fits in a byte's low 3 bits.
+            int32_t typeCounts[8] = {};
+            for(auto& member : members)
+                typeCounts[member.precipitationTypes[point] & 7]++;
+
+            reduced.precipitationTypes[point] = static_cast<PrecipitationType>(max_element(begin(typeCounts), end(typeCounts)) - begin(typeCounts));
+        }
+    }
+}
\ No newline at end of file
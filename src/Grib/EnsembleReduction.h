@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Grib.h"
+
+#include <stddef.h>
+#include <vector>
+
+enum EnsemblePercentile : uint8_t
+{
+    TenthPercentile,
+    FiftiethPercentile,
+    NinetiethPercentile,
+    EnsemblePercentileCount
+};
+
+//What the members of an ensemble say about one point for one forecast hour, beyond the median that goes into its Wx.
+struct EnsembleStats
+{
+    //Share of the members with more than 0.01" of new precipitation, and with the temperature below 32ºF, from 0 to 1.
+    float precipitationChance, freezingChance;
+    float temperature[EnsemblePercentileCount], newPrecipitation[EnsemblePercentileCount];
+};
+
+//Collapses one forecast hour of every member, each already through the temporal derivations, into reduced, which gets the members'
+//median for every field they all have, and their most common precipitation type. stats gets one EnsembleStats per point.
+void ReduceEnsembleHour(const std::vector<RawForecastHour>& members, size_t numberOfPoints, RawForecastHour& reduced, std::vector<EnsembleStats>& stats);
\ No newline at end of file
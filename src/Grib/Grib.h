@@ -1,12 +1,83 @@
 #pragma once
+#include "Wx.h"
+
 #include <stdint.h>
+#include <vector>
+
+//GEFS is the GFS ensemble, every member of it read and reduced down into one forecast.
+enum WeatherModel { NoWeatherModel, HRRR, GFS, GEFS };
 
-enum WeatherModel { NoWeatherModel, HRRR, GFS };
+//GFS goes to 3 hourly after hour 120. GEFS is 3 hourly from the start, and 6 hourly after hour 240.
+inline bool IsForecastHourPublished(WeatherModel weatherModel, uint16_t hour) 
+{ 
+    switch(weatherModel)
+    {
+        case WeatherModel::GFS:
+            return hour <= 120 || hour % 3 == 0;
+        case WeatherModel::GEFS:
+            return hour % 3 == 0 && (hour <= 240 || hour % 6 == 0);
+        default:
+            return true;
+    }
+}
 
+inline const char* GetWeatherModelName(WeatherModel weatherModel)
+{
+    switch(weatherModel)
+    {
+        case WeatherModel::HRRR:
+            return "HRRR";
+        case WeatherModel::GFS:
+            return "GFS";
+        case WeatherModel::GEFS:
+            return "GEFS";
+        default:
+            return "unknown";
+    }
+}
+
+//Every field the readers pull out of a GRIB message. Anything else is UnusedGribField and is never decoded.
+enum GribField : uint8_t
+{
+    CategoricalRainField,
+    CategoricalFreezingRainField,
+    CategoricalSnowField,
+    PrecipitationRateField,
+    TotalPrecipitationField,
+    NewPrecipitationField,
+    //tp as it comes, when a model only has buckets and no 0-N total, like GEFS. Only ever read by the temporal derivations.
+    PrecipitationBucketField,
+    SnowDepthField,
+    TotalSnowField,
+    DewpointField,
+    TemperatureField,
+    TotalCloudCoverField,
+    VisibilityField,
+    WindSpeedField,
+    GustField,
+    WindUField,
+    WindVField,
+    PressureField,
+    LightningField,
+    GribFieldCount,
+    UnusedGribField = GribFieldCount
+};
+
+inline bool IsCategoricalGribField(GribField field) { return field <= GribField::CategoricalSnowField; }
+
+//The header keys of a single GRIB message.
 struct FieldData 
 {
-    uint16_t index;
     int32_t parameterNumber;
     const char* name, *level, *shortName, *stepRange, *typeOfLevel;
-    double value;
+};
+
+//The values of one forecast hour, already converted out of GRIB units, one contiguous column per field, indexed by position in validIndexes.
+//A column stays empty if none of the hour's messages had that field. The categorical fields are merged into precipitationTypes instead.
+struct RawForecastHour
+{
+    std::vector<PrecipitationType> precipitationTypes;
+    std::vector<double> fields[GribFieldCount];
+    //The first hour of each field's step range, so an accumulation can tell when its bucket started over ("6-7" after "0-6").
+    int32_t stepStarts[GribFieldCount] = {};
 };
\ No newline at end of file
@@ -0,0 +1,483 @@
+#include "GribArchive.h"
+#include "Error.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <omp.h>
+#include <unistd.h>
+#include <zstd.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static const char gribArchiveMagic[4] = {'L', 'F', 'G', 'A'};
+static const uint32_t gribArchiveVersion = 1;
+//Most runs are a few dozen hours, so reading one frame back never decodes more than a handful ahead of it.
+static const uint32_t keyframeInterval = 6;
+//zstd's default. Higher levels barely shrink what's left after the differences, and cost a lot more to write.
+static const int32_t compressionLevel = 3;
+
+//Streams below TypesStream are the column for that GribField.
+enum GribArchiveStreamId : uint32_t
+{
+    TypesStream = 0x100,
+    EnsembleStatsStream
+};
+
+//The blocks at the start of the table, ahead of every file's.
+enum GribArchiveStaticBlock : uint32_t
+{
+    ValidIndexesBlock,
+    CoordsBlock,
+    QuadsBlock,
+    InterpolatedFilesBlock,
+    StaticBlockCount
+};
+
+//Followed by streamCount Streams, then StaticBlockCount + numberOfFiles * streamCount Blocks, then the blocks themselves.
+struct GribArchiveHeader {
+    char magic[4];
+    uint32_t version, keyframeInterval, streamCount;
+    uint64_t numberOfFiles, numberOfPoints;
+};
+
+struct GribArchiveReader::Stream {
+    uint32_t id;
+    float step;
+};
+
+//Where a zstd frame is in the file, and how big it is once it's decompressed.
+struct GribArchiveReader::Block {
+    uint64_t offset, length, rawLength;
+};
+
+typedef GribArchiveReader::Stream ArchiveStream;
+typedef GribArchiveReader::Block ArchiveBlock;
+
+static_assert(sizeof(EnsembleStats) % sizeof(uint32_t) == 0);
+
+GribArchivePrecision GetDefaultGribArchivePrecision()
+{
+    GribArchivePrecision precision = {};
+    precision[GribField::PrecipitationRateField] = 0.001f;
+    precision[GribField::TotalPrecipitationField] = precision[GribField::NewPrecipitationField] = 0.01f;
+    precision[GribField::SnowDepthField] = precision[GribField::TotalSnowField] = 0.1f;
+    precision[GribField::DewpointField] = precision[GribField::TemperatureField] = 0.1f;
+    precision[GribField::TotalCloudCoverField] = 1.0f;
+    precision[GribField::VisibilityField] = 0.1f;
+    precision[GribField::WindSpeedField] = precision[GribField::GustField] = 0.1f;
+    precision[GribField::WindUField] = precision[GribField::WindVField] = 0.1f;
+    precision[GribField::PressureField] = 0.001f;
+    //Flash density, where anything above 0 is drawn as lightning, so it's kept fine enough that little of it rounds away.
+    precision[GribField::LightningField] = 0.001f;
+    return precision;
+}
+
+fs::path GetGribArchivePath(const fs::path& directory, time_t forecastStart)
+{
+    tm runStart = {};
+    gmtime_r(&forecastStart, &runStart);
+
+    char fileName[32] = {0};
+    strftime(fileName, sizeof(fileName), "gribdata-%Y%m%d%H.lfa", &runStart);
+    return directory / fileName;
+}
+
+void RemoveOldGribArchives(const fs::path& directory, size_t keep)
+{
+    error_code ec;
+    vector<fs::path> archives;
+    for(auto& entry : fs::directory_iterator(directory, ec))
+    {
+        auto fileName = entry.path().filename().string();
+        if(fileName.starts_with("gribdata-") && fileName.ends_with(".lfa"))
+            archives.push_back(entry.path());
+    }
+
+    if(archives.size() <= keep)
+        return;
+
+    sort(archives.begin(), archives.end());
+    for(size_t i = 0; i < archives.size() - keep; i++)
+        fs::remove(archives[i], ec);
+}
+
+//So small differences either way both come out as small numbers.
+inline uint32_t ZigZag(int32_t value) { return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31); }
+inline int32_t UnZigZag(uint32_t value) { return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1); }
+
+//Differences wrap around instead of overflowing, so one to or from missingValue still decodes back exactly.
+inline int32_t WrappingAdd(int32_t a, int32_t b) { return static_cast<int32_t>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b)); }
+inline int32_t WrappingSubtract(int32_t a, int32_t b) { return static_cast<int32_t>(static_cast<uint32_t>(a) - static_cast<uint32_t>(b)); }
+
+//The quantized value a missing value is written as. Nothing finite quantizes to it, they're clamped to INT32_MAX either way.
+static const int32_t missingValue = INT32_MIN;
+
+inline int32_t Quantize(float value, float step)
+{
+    if(!isfinite(value))
+        return missingValue;
+
+    return static_cast<int32_t>(clamp(nearbyint(static_cast<double>(value) / step), -static_cast<double>(INT32_MAX), static_cast<double>(INT32_MAX)));
+}
+
+//Every value's first byte, then every value's second, so the high bytes that are nearly always zero end up next to each other.
+inline void Shuffle(const uint32_t* values, size_t count, uint8_t* bytes)
+{
+    for(size_t b = 0; b < sizeof(uint32_t); b++)
+    {
+        auto plane = bytes + b * count;
+        for(size_t i = 0; i < count; i++)
+            plane[i] = static_cast<uint8_t>(values[i] >> (b * 8));
+    }
+}
+
+inline void Unshuffle(const uint8_t* bytes, size_t count, uint32_t* values)
+{
+    auto plane0 = bytes, plane1 = bytes + count, plane2 = bytes + count * 2, plane3 = bytes + count * 3;
+
+    #pragma omp simd
+    for(size_t i = 0; i < count; i++)
+        values[i] = plane0[i] | (plane1[i] << 8) | (plane2[i] << 16) | (static_cast<uint32_t>(plane3[i]) << 24);
+}
+
+static vector<uint8_t> Compress(const void* data, size_t length)
+{
+    vector<uint8_t> compressed(ZSTD_compressBound(length));
+    auto result = ZSTD_compress(compressed.data(), compressed.size(), data, length, compressionLevel);
+    if(ZSTD_isError(result))
+        ERR_OUT("Unable to compress archive block: " << ZSTD_getErrorName(result));
+
+    compressed.resize(result);
+    return compressed;
+}
+
+inline vector<uint8_t> CompressShuffled(const uint32_t* values, size_t count, vector<uint8_t>& shuffled)
+{
+    Shuffle(values, count, shuffled.data());
+    return Compress(shuffled.data(), count * sizeof(uint32_t));
+}
+
+//previous holds the hour before's quantized values going in, and this hour's coming out.
+static void EncodeField(span<const float> values, float step, bool keyframe, vector<int32_t>& previous, vector<uint32_t>& coded)
+{
+    int32_t lastDelta = 0;
+    for(size_t point = 0; point < values.size(); point++)
+    {
+        auto quantized = Quantize(values[point], step);
+        auto delta = keyframe ? quantized : WrappingSubtract(quantized, previous[point]);
+        previous[point] = quantized;
+        coded[point] = ZigZag(WrappingSubtract(delta, lastDelta));
+        lastDelta = delta;
+    }
+}
+
+//values can be null for an hour that's only decoded to get to the next one.
+static void DecodeField(const vector<uint32_t>& coded, float step, bool keyframe, vector<int32_t>& previous, float* values)
+{
+    int32_t delta = 0;
+    for(size_t point = 0; point < coded.size(); point++)
+    {
+        delta = WrappingAdd(delta, UnZigZag(coded[point]));
+        previous[point] = keyframe ? delta : WrappingAdd(previous[point], delta);
+    }
+
+    if(!values)
+        return;
+
+    #pragma omp simd
+    for(size_t point = 0; point < coded.size(); point++)
+        values[point] = previous[point] == missingValue ? NAN : previous[point] * step;
+}
+
+void SaveGribArchive(const fs::path& path, GribData& gribData, const GribArchivePrecision& precision)
+{
+    auto numberOfFiles = gribData.GetNumberOfFiles(), numberOfPoints = gribData.GetNumberOfPoints();
+
+    for(auto field : wxFields)
+    {
+        //Written so NaN fails it too.
+        if(!(precision[field] > 0))
+            ERR_OUT("Archive step for field " << static_cast<int32_t>(field) << " is " << precision[field] << ", it has to be more than 0.");
+    }
+
+    vector<ArchiveStream> streams;
+    for(auto field : wxFields)
+    {
+        if(numberOfFiles && !gribData.GetField(field, 0).empty())
+            streams.push_back({ field, precision[field] });
+    }
+
+    if(numberOfFiles && !gribData.GetTypes(0).empty())
+        streams.push_back({ TypesStream, 0 });
+    if(gribData.IsEnsemble())
+        streams.push_back({ EnsembleStatsStream, 0 });
+
+    //Left empty when none of the files were filled in, same as in GribData.
+    vector<uint8_t> interpolatedFiles(numberOfFiles);
+    for(size_t file = 0; file < numberOfFiles; file++)
+        interpolatedFiles[file] = gribData.IsInterpolated(file);
+
+    if(none_of(interpolatedFiles.begin(), interpolatedFiles.end(), [](uint8_t interpolated) { return interpolated; }))
+        interpolatedFiles.clear();
+
+    auto validIndexes = gribData.GetValidIndexes();
+    auto coords = gribData.GetGeoCoords();
+    auto quadIndexes = gribData.GetQuadIndexes();
+
+    vector<vector<uint8_t>> encoded(StaticBlockCount + numberOfFiles * streams.size());
+    vector<uint64_t> rawLengths(encoded.size());
+    encoded[ValidIndexesBlock] = Compress(validIndexes.data(), rawLengths[ValidIndexesBlock] = validIndexes.size_bytes());
+    encoded[CoordsBlock] = Compress(coords.data(), rawLengths[CoordsBlock] = coords.size() * sizeof(GeoCoord));
+    encoded[QuadsBlock] = Compress(quadIndexes.data(), rawLengths[QuadsBlock] = quadIndexes.size_bytes());
+    encoded[InterpolatedFilesBlock] = Compress(interpolatedFiles.data(), rawLengths[InterpolatedFilesBlock] = interpolatedFiles.size());
+
+    //Each stream only depends on itself, and only back as far as its keyframe, so every stretch between keyframes is its own job.
+    auto groups = (numberOfFiles + keyframeInterval - 1) / keyframeInterval;
+    #pragma omp parallel
+    {
+        vector<int32_t> previous(numberOfPoints);
+        vector<uint32_t> coded(numberOfPoints);
+        vector<uint8_t> shuffled(numberOfPoints * sizeof(EnsembleStats));
+
+        #pragma omp for collapse(2) schedule(dynamic)
+        for(size_t group = 0; group < groups; group++)
+        {
+            for(size_t stream = 0; stream < streams.size(); stream++)
+            {
+                auto& archiveStream = streams[stream];
+                auto lastFile = min(numberOfFiles, (group + 1) * keyframeInterval);
+                for(auto file = group * keyframeInterval; file < lastFile; file++)
+                {
+                    auto block = StaticBlockCount + file * streams.size() + stream;
+                    if(archiveStream.id == TypesStream)
+                    {
+                        auto types = gribData.GetTypes(file);
+                        encoded[block] = Compress(types.data(), rawLengths[block] = types.size_bytes());
+                    }
+                    else if(archiveStream.id == EnsembleStatsStream)
+                    {
+                        auto words = numberOfPoints * sizeof(EnsembleStats) / sizeof(uint32_t);
+                        encoded[block] = CompressShuffled(reinterpret_cast<const uint32_t*>(gribData.GetEnsembleStats(0, file)), words, shuffled);
+                        rawLengths[block] = words * sizeof(uint32_t);
+                    }
+                    else
+                    {
+                        auto values = gribData.GetField(static_cast<GribField>(archiveStream.id), file);
+                        EncodeField(values, archiveStream.step, file % keyframeInterval == 0, previous, coded);
+                        encoded[block] = CompressShuffled(coded.data(), numberOfPoints, shuffled);
+                        rawLengths[block] = numberOfPoints * sizeof(uint32_t);
+                    }
+                }
+            }
+        }
+    }
+
+    GribArchiveHeader header = {};
+    memcpy(header.magic, gribArchiveMagic, sizeof(gribArchiveMagic));
+    header.version = gribArchiveVersion;
+    header.keyframeInterval = keyframeInterval;
+    header.streamCount = static_cast<uint32_t>(streams.size());
+    header.numberOfFiles = numberOfFiles;
+    header.numberOfPoints = numberOfPoints;
+
+    vector<ArchiveBlock> blocks(encoded.size());
+    auto offset = sizeof(GribArchiveHeader) + streams.size() * sizeof(ArchiveStream) + blocks.size() * sizeof(ArchiveBlock);
+    for(size_t block = 0; block < blocks.size(); block++)
+    {
+        blocks[block] = { offset, encoded[block].size(), rawLengths[block] };
+        offset += encoded[block].size();
+    }
+
+    //Written to the side and renamed in, so a run that dies halfway never leaves a file that looks usable.
+    auto tempPath = fs::path(path).concat(".tmp");
+    auto f = fopen(tempPath.c_str(), "wb");
+    if(!f)
+        ERR_OUT("Unable to open " << tempPath);
+
+    fwrite(&header, sizeof(GribArchiveHeader), 1, f);
+    fwrite(streams.data(), sizeof(ArchiveStream), streams.size(), f);
+    fwrite(blocks.data(), sizeof(ArchiveBlock), blocks.size(), f);
+    for(auto& block : encoded)
+        fwrite(block.data(), sizeof(uint8_t), block.size(), f);
+
+    fclose(f);
+
+    error_code ec;
+    fs::rename(tempPath, path, ec);
+    if(ec)
+        ERR_OUT("Unable to move " << tempPath << " to " << path << ": " << ec.message());
+}
+
+GribArchiveReader::~GribArchiveReader()
+{
+    if(fd != -1)
+        close(fd);
+}
+
+GribArchiveReader* GribArchiveReader::Open(const fs::path& path)
+{
+    auto fd = open(path.c_str(), O_RDONLY);
+    if(fd == -1)
+        ERR_OUT("Unable to open " << path);
+
+    auto result = new GribArchiveReader();
+    result->fd = fd;
+    result->path = path;
+
+    GribArchiveHeader header = {};
+    if(pread(fd, &header, sizeof(GribArchiveHeader), 0) != sizeof(GribArchiveHeader) || memcmp(header.magic, gribArchiveMagic, sizeof(gribArchiveMagic)))
+        ERR_OUT(path << " isn't a GribData archive.");
+
+    if(header.version != gribArchiveVersion)
+        ERR_OUT(path << " is version " << header.version << ", this only reads " << gribArchiveVersion << ".");
+
+    if(!header.keyframeInterval)
+        ERR_OUT(path << " is corrupt.");
+
+    result->numberOfFiles = header.numberOfFiles;
+    result->numberOfPoints = header.numberOfPoints;
+    result->keyframeInterval = header.keyframeInterval;
+
+    result->streams.resize(header.streamCount);
+    vector<ArchiveBlock> staticBlocks(StaticBlockCount);
+    result->blocks.resize(header.numberOfFiles * header.streamCount);
+
+    auto offset = sizeof(GribArchiveHeader);
+    auto readTable = [&](void* table, size_t length) {
+        if(pread(fd, table, length, offset) != static_cast<ssize_t>(length))
+            ERR_OUT(path << " is truncated.");
+
+        offset += length;
+    };
+
+    readTable(result->streams.data(), result->streams.size() * sizeof(ArchiveStream));
+    for(auto& stream : result->streams)
+    {
+        if(stream.id < GribFieldCount && !(stream.step > 0))
+            ERR_OUT(path << " is corrupt, field " << stream.id << " has a step of " << stream.step << ".");
+    }
+
+    readTable(staticBlocks.data(), staticBlocks.size() * sizeof(ArchiveBlock));
+    readTable(result->blocks.data(), result->blocks.size() * sizeof(ArchiveBlock));
+
+    vector<uint8_t> compressed, raw;
+    auto readStatic = [&](GribArchiveStaticBlock block, auto& values) {
+        result->ReadBlock(staticBlocks[block], compressed, raw);
+        values.resize(raw.size() / sizeof(values[0]));
+        memcpy(values.data(), raw.data(), raw.size());
+    };
+
+    readStatic(ValidIndexesBlock, result->validIndexes);
+    readStatic(CoordsBlock, result->coords);
+    readStatic(QuadsBlock, result->quadIndexes);
+    readStatic(InterpolatedFilesBlock, result->interpolatedFiles);
+    if(result->validIndexes.size() != result->numberOfPoints || result->coords.size() != result->numberOfPoints)
+        ERR_OUT(path << " is missing its points.");
+
+    return result;
+}
+
+void GribArchiveReader::ReadBlock(const Block& block, vector<uint8_t>& compressed, vector<uint8_t>& raw)
+{
+    compressed.resize(block.length);
+    raw.resize(block.rawLength);
+    if(pread(fd, compressed.data(), block.length, block.offset) != static_cast<ssize_t>(block.length))
+        ERR_OUT(path << " is truncated.");
+
+    auto result = ZSTD_decompress(raw.data(), raw.size(), compressed.data(), compressed.size());
+    if(ZSTD_isError(result) || result != raw.size())
+        ERR_OUT(path << " is corrupt: " << (ZSTD_isError(result) ? ZSTD_getErrorName(result) : "block is the wrong size"));
+}
+
+void GribArchiveReader::DecodeStream(size_t stream, size_t firstFile, size_t lastFile, size_t outputFirstFile, GribData::WxColumns& fields, vector<PrecipitationType>& types, vector<EnsembleStats>& ensembleStats)
+{
+    auto& archiveStream = streams[stream];
+    auto isField = archiveStream.id < GribFieldCount;
+    if(!isField && archiveStream.id != TypesStream && archiveStream.id != EnsembleStatsStream)
+        return;
+
+    vector<uint8_t> compressed, raw;
+    vector<int32_t> previous(numberOfPoints);
+    vector<uint32_t> coded(numberOfPoints);
+    for(auto file = firstFile; file <= lastFile; file++)
+    {
+        ReadBlock(blocks[file * streams.size() + stream], compressed, raw);
+
+        auto output = file >= outputFirstFile;
+        auto at = (file - outputFirstFile) * numberOfPoints;
+        if(archiveStream.id == TypesStream)
+        {
+            if(output && raw.size() == numberOfPoints * sizeof(PrecipitationType))
+                memcpy(types.data() + at, raw.data(), raw.size());
+        }
+        else if(archiveStream.id == EnsembleStatsStream)
+        {
+            if(output && raw.size() == numberOfPoints * sizeof(EnsembleStats))
+                Unshuffle(raw.data(), raw.size() / sizeof(uint32_t), reinterpret_cast<uint32_t*>(ensembleStats.data() + at));
+        }
+        else
+        {
+            if(raw.size() != numberOfPoints * sizeof(uint32_t))
+                ERR_OUT(path << " has a block at the wrong size.");
+
+            Unshuffle(raw.data(), numberOfPoints, coded.data());
+            auto values = output ? fields[archiveStream.id].data() + at : nullptr;
+            DecodeField(coded, archiveStream.step, file % keyframeInterval == 0, previous, values);
+        }
+    }
+}
+
+GribData* GribArchiveReader::Decode(size_t firstFile, size_t lastFile, size_t outputFirstFile)
+{
+    auto outputFiles = lastFile + 1 - outputFirstFile;
+
+    GribData::WxColumns fields;
+    vector<PrecipitationType> types;
+    vector<EnsembleStats> ensembleStats;
+    for(auto& stream : streams)
+    {
+        if(stream.id < GribFieldCount)
+            fields[stream.id].resize(outputFiles * numberOfPoints);
+        else if(stream.id == TypesStream)
+            types.resize(outputFiles * numberOfPoints);
+        else if(stream.id == EnsembleStatsStream)
+            ensembleStats.resize(outputFiles * numberOfPoints);
+    }
+
+    vector<size_t> groupStarts;
+    for(auto file = firstFile; file <= lastFile; file += keyframeInterval)
+        groupStarts.push_back(file);
+
+    #pragma omp parallel for collapse(2) schedule(dynamic)
+    for(size_t group = 0; group < groupStarts.size(); group++)
+    {
+        for(size_t stream = 0; stream < streams.size(); stream++)
+            DecodeStream(stream, groupStarts[group], min(lastFile, groupStarts[group] + keyframeInterval - 1), outputFirstFile, fields, types, ensembleStats);
+    }
+
+    vector<uint8_t> outputInterpolatedFiles;
+    if(!interpolatedFiles.empty())
+        outputInterpolatedFiles.assign(interpolatedFiles.begin() + outputFirstFile, interpolatedFiles.begin() + lastFile + 1);
+
+    return new GribData(outputFiles, validIndexes, coords, quadIndexes, std::move(fields), std::move(types), std::move(outputInterpolatedFiles), std::move(ensembleStats));
+}
+
+GribData* GribArchiveReader::ReadAll()
+{
+    if(!numberOfFiles)
+        return new GribData(0, validIndexes, coords, quadIndexes, {}, {});
+
+    return Decode(0, numberOfFiles - 1, 0);
+}
+
+GribData* GribArchiveReader::ReadFile(int32_t fileIndex)
+{
+    if(fileIndex < 0 || static_cast<size_t>(fileIndex) >= numberOfFiles)
+        ERR_OUT(path << " has no file " << fileIndex << ", only " << numberOfFiles << ".");
+
+    return Decode(fileIndex - fileIndex % keyframeInterval, fileIndex, fileIndex);
+}
\ No newline at end of file
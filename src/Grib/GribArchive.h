@@ -0,0 +1,70 @@
+#pragma once
+
+#include "GribData.h"
+
+#include <array>
+#include <ctime>
+#include <filesystem>
+#include <vector>
+
+//Quantization step for each field, in the units GribData keeps it in (ºF, inches, mph...). Every one has to be more than 0.
+typedef std::array<float, GribFieldCount> GribArchivePrecision;
+
+//0.1ºF, 0.01" of precipitation, 0.1" of snow, and about as fine as anything gets drawn or written out for the rest.
+GribArchivePrecision GetDefaultGribArchivePrecision();
+
+//One per run, named by when it starts, so they sort oldest to newest.
+std::filesystem::path GetGribArchivePath(const std::filesystem::path& directory, time_t forecastStart);
+
+//Keeps the newest keep archives in directory and removes the rest.
+void RemoveOldGribArchives(const std::filesystem::path& directory, size_t keep);
+
+//Each field is quantized to its step, then taken as the difference from the hour before and then from the point before,
+//which leaves mostly zeros and small numbers for zstd. Missing values (NaN or inf) come back as NaN. Every few hours is a keyframe that only differs from the point before,
+//so any one hour can be read back without every hour ahead of it. Precipitation types and ensemble stats are kept as they are.
+void SaveGribArchive(const std::filesystem::path& path, GribData& gribData, const GribArchivePrecision& precision);
+
+//Reads a file written by SaveGribArchive, only the blocks that are asked for, and decodes them straight into GribData's columns.
+class GribArchiveReader
+{
+public:
+    //As they're laid out in the file, see GribArchive.cpp.
+    struct Stream;
+    struct Block;
+
+private:
+    int fd = -1;
+    std::filesystem::path path;
+    size_t numberOfFiles = 0, numberOfPoints = 0;
+    uint32_t keyframeInterval = 0;
+    std::vector<Stream> streams;
+    //Every file's block for each stream, file by file.
+    std::vector<Block> blocks;
+    std::vector<int32_t> validIndexes;
+    std::vector<GeoCoord> coords;
+    std::vector<QuadIndexes> quadIndexes;
+    std::vector<uint8_t> interpolatedFiles;
+
+    GribArchiveReader() = default;
+
+    //raw comes back the block's rawLength, decompressed. compressed is only scratch space.
+    void ReadBlock(const Block& block, std::vector<uint8_t>& compressed, std::vector<uint8_t>& raw);
+    //Decodes every file of stream from firstFile to lastFile, which has to start on a keyframe. Only the files from outputFirstFile on
+    //are written out, to the columns, which start at outputFirstFile. The ones before it are only decoded to get to it.
+    void DecodeStream(size_t stream, size_t firstFile, size_t lastFile, size_t outputFirstFile, GribData::WxColumns& fields, std::vector<PrecipitationType>& types, std::vector<EnsembleStats>& ensembleStats);
+    GribData* Decode(size_t firstFile, size_t lastFile, size_t outputFirstFile);
+
+public:
+    GribArchiveReader(const GribArchiveReader&) = delete;
+    GribArchiveReader& operator=(const GribArchiveReader&) = delete;
+    ~GribArchiveReader();
+
+    static GribArchiveReader* Open(const std::filesystem::path& path);
+
+    inline size_t GetNumberOfFiles() const { return numberOfFiles; }
+
+    //Every file, each stream between each pair of keyframes decoded on a thread of its own.
+    GribData* ReadAll();
+    //Just the one file, decoded from the keyframe at or before it.
+    GribData* ReadFile(int32_t fileIndex);
+};
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "BoundedQueue.h"
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class GribBufferPool;
+
+//A whole forecast hour's GRIB, straight off the wire.
+struct GribBuffer {
+    uint16_t gribNumber = 0;
+    std::string bytes;
+    //Everyone still reading it (decoder, archiver). It goes back to the pool when the last one lets go.
+    std::atomic<int32_t> users = 0;
+    GribBufferPool* pool = nullptr;
+
+    inline void Release();
+};
+
+//A fixed set of buffers that go around from the downloads to the decoder (and archiver) and back, so each response lands in memory
+//that's already been grown to fit one, and so no more than the pool's worth of hours are ever held at once.
+class GribBufferPool
+{
+private:
+    std::vector<std::unique_ptr<GribBuffer>> buffers;
+    BoundedQueue<GribBuffer*> available;
+
+public:
+    GribBufferPool(size_t count) : available(count)
+    {
+        for(size_t i = 0; i < available.GetCapacity(); i++)
+        {
+            buffers.push_back(std::make_unique<GribBuffer>());
+            buffers.back()->pool = this;
+            available.Push(buffers.back().get());
+        }
+    }
+
+    //Blocks until one comes back if they're all out.
+    GribBuffer* Take(uint16_t gribNumber, int32_t users)
+    {
+        GribBuffer* buffer = nullptr;
+        available.Pop(buffer);
+        buffer->gribNumber = gribNumber;
+        buffer->bytes.clear();
+        buffer->users = users;
+        return buffer;
+    }
+
+    inline void Return(GribBuffer* buffer) { available.Push(buffer); }
+    inline size_t GetSize() const { return buffers.size(); }
+};
+
+inline void GribBuffer::Release()
+{
+    if(--users == 0)
+        pool->Return(this);
+}
+
+//A forecast hour that's ready to decode. With no buffer it's on disk at the usual path.
+struct LandedGrib {
+    uint16_t gribNumber = 0;
+    GribBuffer* buffer = nullptr;
+};
\ No newline at end of file
@@ -1,58 +1,237 @@
 #include "GribData.h"
 #include "Error.h"
 
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 using namespace std;
 
-const WxAtGeoCoord GribData::emptyWx = {};
+static const char gribDataMagic[4] = {'L', 'F', 'G', 'D'};
+static const uint32_t gribDataVersion = 1;
+//Every section starts on a cache line, which keeps every array in the mapping aligned for whatever's in it.
+static const size_t gribDataAlignment = 64;
 
-vector<GeoCoord> GribData::GetGeoCoords()
+//Sections below ValidIndexesSection are the column for that GribField.
+enum GribDataSectionId : uint32_t
 {
-    vector<GeoCoord> result;
-    result.reserve(geoCoordLookup.size());
-    
-    for(auto& pair : geoCoordLookup)
-        result.push_back(pair.first);
+    ValidIndexesSection = 0x100,
+    CoordsSection,
+    //Point ids sorted by coordinate, from when points were looked up by GeoCoord. Skipped if it's there.
+    RetiredPointsByCoordSection,
+    QuadsSection,
+    TypesSection,
+    InterpolatedFilesSection,
+    EnsembleStatsSection
+};
 
-    return result;
+//Where a section is in the file, in bytes. elementSize is checked on load so a struct that's changed size since the file was written isn't misread.
+struct GribDataSection {
+    uint32_t id, elementSize;
+    uint64_t offset, length;
+};
+
+//Followed by sectionCount GribDataSections, then the sections themselves.
+//Files from before there was a header start right in on numberOfFiles, which is never going to look like the magic.
+struct GribDataHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t gridHash, numberOfFiles, numberOfPoints, numberOfQuads, sectionCount;
+    //Of everything after the header, a word at a time.
+    uint64_t checksum;
+};
+
+static_assert(sizeof(GribDataHeader) % alignof(GribDataSection) == 0);
+
+static const uint64_t fnvOffsetBasis = 14695981039346656037ull, fnvPrime = 1099511628211ull;
+
+//FNV-1a over 8 bytes at a time instead of one, which is plenty to catch a truncated or scribbled on file, and fast enough to run on every load.
+inline uint64_t ChecksumWords(uint64_t hash, const uint8_t* bytes, size_t length)
+{
+    for(size_t i = 0; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(uint64_t));
+        hash = (hash ^ word) * fnvPrime;
+    }
+
+    return hash;
+}
+
+inline size_t AlignSection(size_t length) { return (length + gribDataAlignment - 1) / gribDataAlignment * gribDataAlignment; }
+
+//Writes through to f, keeping the checksum as it goes, so the file never has to be read back to get it.
+class GribDataWriter
+{
+private:
+    FILE* f;
+    uint64_t checksum = fnvOffsetBasis;
+    uint8_t partialWord[sizeof(uint64_t)];
+    size_t partialLength = 0, written = 0;
+
+public:
+    GribDataWriter(FILE* f) : f(f) {}
+
+    void Write(const void* data, size_t length)
+    {
+        if(!length)
+            return;
+
+        fwrite(data, 1, length, f);
+        written += length;
+
+        auto bytes = static_cast<const uint8_t*>(data);
+        if(partialLength)
+        {
+            auto needed = min(sizeof(uint64_t) - partialLength, length);
+            memcpy(partialWord + partialLength, bytes, needed);
+            partialLength += needed;
+            bytes += needed;
+            length -= needed;
+            if(partialLength < sizeof(uint64_t))
+                return;
+
+            checksum = ChecksumWords(checksum, partialWord, sizeof(uint64_t));
+            partialLength = 0;
+        }
+
+        auto wholeWords = length / sizeof(uint64_t) * sizeof(uint64_t);
+        checksum = ChecksumWords(checksum, bytes, wholeWords);
+        partialLength = length - wholeWords;
+        memcpy(partialWord, bytes + wholeWords, partialLength);
+    }
+
+    //Counting the header, which isn't written through here.
+    void PadToAlignment()
+    {
+        static const uint8_t zeros[gribDataAlignment] = {};
+        Write(zeros, AlignSection(sizeof(GribDataHeader) + written) - sizeof(GribDataHeader) - written);
+    }
+
+    //Only once everything's been padded out to a whole word.
+    inline uint64_t GetChecksum() { return checksum; }
+};
+
+GribData::GribData(size_t numberOfFiles, vector<int32_t> validIndexes, vector<GeoCoord> coords, vector<QuadIndexes> quadIndexes, WxColumns fields, vector<PrecipitationType> types, 
+    vector<uint8_t> interpolatedFiles, vector<EnsembleStats> ensembleStats)
+    : owned(new OwnedData { std::move(validIndexes), std::move(coords), std::move(quadIndexes), std::move(fields), std::move(types), std::move(interpolatedFiles), std::move(ensembleStats) }),
+      numberOfFiles(numberOfFiles)
+{
+    this->validIndexes = owned->validIndexes;
+    this->coords = owned->coords;
+    this->quadIndexes = owned->quadIndexes;
+    for(auto field = 0; field < GribFieldCount; field++)
+        this->fields[field] = owned->fields[field];
+
+    this->types = owned->types;
+    this->interpolatedFiles = owned->interpolatedFiles;
+    this->ensembleStats = owned->ensembleStats;
+    gridHash = HashGrid(this->validIndexes, this->coords);
+}
+
+GribData::~GribData()
+{
+    if(mapping)
+        munmap(mapping, mappingLength);
+}
+
+uint64_t GribData::HashGrid(span<const int32_t> validIndexes, span<const GeoCoord> coords)
+{
+    auto hash = fnvOffsetBasis;
+    auto hashBytes = [&](const void* data, size_t length) {
+        auto bytes = static_cast<const uint8_t*>(data);
+        for(size_t i = 0; i < length; i++)
+            hash = (hash ^ bytes[i]) * fnvPrime;
+    };
+
+    hashBytes(validIndexes.data(), validIndexes.size_bytes());
+    hashBytes(coords.data(), coords.size_bytes());
+    return hash;
+}
+
+vector<QuadIndexes> GribData::ToPointQuads(const vector<int32_t>& validIndexes, const vector<QuadIndexes>& gridQuads)
+{
+    //Grid indexes are dense enough that a plain array beats hashing every corner.
+    vector<int32_t> pointAt(validIndexes.empty() ? 0 : *max_element(validIndexes.begin(), validIndexes.end()) + 1, -1);
+    for(size_t point = 0; point < validIndexes.size(); point++)
+        pointAt[validIndexes[point]] = static_cast<int32_t>(point);
+
+    vector<QuadIndexes> pointQuads(gridQuads.size());
+    for(size_t i = 0; i < gridQuads.size(); i++)
+    {
+        auto& quad = gridQuads[i];
+        pointQuads[i] = { pointAt[quad.topLeft], pointAt[quad.topRight], pointAt[quad.bottomLeft], pointAt[quad.bottomRight] };
+    }
+
+    return pointQuads;
 }
 
 void GribData::Save(std::filesystem::path path)
 {
-    auto f = fopen(path.c_str(), "wb");
-    if(!f)
-        ERR_OUT("Unable to open " << path);
+    vector<GribDataSection> sections = {
+        { ValidIndexesSection, sizeof(int32_t), 0, validIndexes.size_bytes() },
+        { CoordsSection, sizeof(GeoCoord), 0, coords.size_bytes() },
+        { QuadsSection, sizeof(QuadIndexes), 0, quadIndexes.size_bytes() },
+        { TypesSection, sizeof(PrecipitationType), 0, types.size_bytes() },
+        { InterpolatedFilesSection, sizeof(uint8_t), 0, interpolatedFiles.size_bytes() },
+        { EnsembleStatsSection, sizeof(EnsembleStats), 0, ensembleStats.size_bytes() }
+    };
 
-    fwrite(&numberOfFiles, sizeof(size_t), 1, f);
-    auto len = validIndexes.size();
-    fwrite(&len, sizeof(size_t), 1, f);
-    for(auto& index : validIndexes)
-        fwrite(&index, sizeof(int32_t), 1, f);
+    vector<const void*> sectionData = { validIndexes.data(), coords.data(), quadIndexes.data(), types.data(), interpolatedFiles.data(), ensembleStats.data() };
+    for(auto field : wxFields)
+    {
+        if(fields[field].empty())
+            continue;
 
-    len = quadIndexes.size();
-    fwrite(&len, sizeof(size_t), 1, f);
-    for(auto& quad : quadIndexes)
-        fwrite(&quad, sizeof(QuadIndexes), 1, f);
+        sections.push_back({ field, sizeof(float), 0, fields[field].size_bytes() });
+        sectionData.push_back(fields[field].data());
+    }
 
-    len = geoCoordLookup.size();
-    fwrite(&len, sizeof(size_t), 1, f);
-    for(auto& pair : geoCoordLookup)
+    auto offset = AlignSection(sizeof(GribDataHeader) + sections.size() * sizeof(GribDataSection));
+    for(auto& section : sections)
     {
-        fwrite(&pair.first, sizeof(GeoCoord), 1, f);
-        fwrite(&pair.second, sizeof(int32_t), 1, f);
+        section.offset = offset;
+        offset += AlignSection(section.length);
     }
 
-    for(auto& map : wxResults)
+    GribDataHeader header = {};
+    memcpy(header.magic, gribDataMagic, sizeof(gribDataMagic));
+    header.version = gribDataVersion;
+    header.gridHash = gridHash;
+    header.numberOfFiles = numberOfFiles;
+    header.numberOfPoints = validIndexes.size();
+    header.numberOfQuads = quadIndexes.size();
+    header.sectionCount = sections.size();
+
+    //Written to the side and renamed in, so a run that dies halfway never leaves a file that looks usable.
+    auto tempPath = std::filesystem::path(path).concat(".tmp");
+    auto f = fopen(tempPath.c_str(), "wb");
+    if(!f)
+        ERR_OUT("Unable to open " << tempPath);
+
+    //The checksum isn't known until the end, so the header is written again once it is.
+    fwrite(&header, sizeof(GribDataHeader), 1, f);
+    GribDataWriter writer(f);
+    writer.Write(sections.data(), sections.size() * sizeof(GribDataSection));
+    writer.PadToAlignment();
+    for(size_t i = 0; i < sections.size(); i++)
     {
-        len = map.size();
-        fwrite(&len, sizeof(size_t), 1, f);
-        for(auto& pair : map)
-        {
-            fwrite(&pair.first, sizeof(int32_t), 1, f);
-            fwrite(&pair.second, sizeof(WxAtGeoCoord), 1, f);
-        }
+        writer.Write(sectionData[i], sections[i].length);
+        writer.PadToAlignment();
     }
 
+    header.checksum = writer.GetChecksum();
+    fseek(f, 0, SEEK_SET);
+    fwrite(&header, sizeof(GribDataHeader), 1, f);
     fclose(f);
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if(ec)
+        ERR_OUT("Unable to move " << tempPath << " to " << path << ": " << ec.message());
 }
 
 GribData* GribData::Load(std::filesystem::path path)
@@ -61,55 +240,205 @@ GribData* GribData::Load(std::filesystem::path path)
     if(!f)
         ERR_OUT("Unable to open " << path);
 
+    char magic[sizeof(gribDataMagic)] = {};
+    if(fread(magic, sizeof(magic), 1, f) == 1 && !memcmp(magic, gribDataMagic, sizeof(gribDataMagic)))
+    {
+        fclose(f);
+        return LoadMapped(path);
+    }
+
+    cout << path << " is from before gribdata.bin could be mapped, reading it all in." << endl;
+    rewind(f);
+    auto result = LoadLegacy(f);
+    fclose(f);
+    return result;
+}
+
+GribData* GribData::LoadMapped(const std::filesystem::path& path)
+{
+    auto fd = open(path.c_str(), O_RDONLY);
+    if(fd == -1)
+        ERR_OUT("Unable to open " << path);
+
+    struct stat fileStat = {};
+    if(fstat(fd, &fileStat) == -1)
+        ERR_OUT("Unable to stat " << path);
+
+    auto length = static_cast<size_t>(fileStat.st_size);
+    if(length < sizeof(GribDataHeader) || length % sizeof(uint64_t))
+        ERR_OUT(path << " is truncated.");
+
+    auto mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED)
+        ERR_OUT("Unable to map " << path);
+
+    auto result = new GribData();
+    result->mapping = mapping;
+    result->mappingLength = length;
+
+    auto bytes = static_cast<const uint8_t*>(mapping);
+    auto header = static_cast<const GribDataHeader*>(mapping);
+    if(header->version != gribDataVersion)
+        ERR_OUT(path << " is version " << header->version << ", this only reads " << gribDataVersion << ". Run without -useCache to rebuild it.");
+
+    //The checksum reads every page anyway, so have the kernel bring them all in at once.
+    madvise(mapping, length, MADV_WILLNEED);
+    if(header->sectionCount > (length - sizeof(GribDataHeader)) / sizeof(GribDataSection)
+        || ChecksumWords(fnvOffsetBasis, bytes + sizeof(GribDataHeader), length - sizeof(GribDataHeader)) != header->checksum)
+        ERR_OUT(path << " is corrupt, its checksum doesn't match. Run without -useCache to rebuild it.");
+
+    result->numberOfFiles = header->numberOfFiles;
+    result->gridHash = header->gridHash;
+
+    auto numberOfPoints = header->numberOfPoints, numberOfValues = header->numberOfFiles * numberOfPoints;
+    auto sections = reinterpret_cast<const GribDataSection*>(bytes + sizeof(GribDataHeader));
+    for(size_t i = 0; i < header->sectionCount; i++)
+    {
+        auto& section = sections[i];
+        if(section.offset % gribDataAlignment || section.offset > length || section.length > length - section.offset)
+            ERR_OUT(path << " has a section outside of the file.");
+
+        //Sections that are empty are written anyway, and come out as an empty span the same as one that's missing.
+        #define MAP_SECTION(member, type, count) { \
+            if(section.elementSize != sizeof(type) || (section.length && section.length != (count) * sizeof(type))) \
+                ERR_OUT(path << " has section " << section.id << " at the wrong size. Run without -useCache to rebuild it."); \
+            result->member = span<const type>(reinterpret_cast<const type*>(bytes + section.offset), section.length / sizeof(type)); \
+        }
+
+        switch(section.id)
+        {
+            case ValidIndexesSection: MAP_SECTION(validIndexes, int32_t, numberOfPoints); break;
+            case CoordsSection: MAP_SECTION(coords, GeoCoord, numberOfPoints); break;
+            case QuadsSection: MAP_SECTION(quadIndexes, QuadIndexes, header->numberOfQuads); break;
+            case TypesSection: MAP_SECTION(types, PrecipitationType, numberOfValues); break;
+            case InterpolatedFilesSection: MAP_SECTION(interpolatedFiles, uint8_t, header->numberOfFiles); break;
+            case EnsembleStatsSection: MAP_SECTION(ensembleStats, EnsembleStats, numberOfValues); break;
+            default:
+                //A field this build doesn't know about is skipped.
+                if(section.id < GribFieldCount)
+                    MAP_SECTION(fields[section.id], float, numberOfValues);
+                break;
+        }
+
+        #undef MAP_SECTION
+    }
+
+    if(result->validIndexes.size() != numberOfPoints || result->coords.size() != numberOfPoints)
+        ERR_OUT(path << " is missing its points. Run without -useCache to rebuild it.");
+
+    return result;
+}
+
+//The unmapped layout: every hour a map of grid index to WxAtGeoCoord, everything keyed by grid index.
+GribData* GribData::LoadLegacy(FILE* f)
+{
     size_t len = 0;
     int32_t int32Value = 0;
-    QuadIndexes quadIndexValue = {};
     GeoCoord geoCoordValue = {};
     WxAtGeoCoord wxAtGeoCoordValue = {};
 
-    int32_t numberOfFiles;
+    size_t numberOfFiles = 0;
     std::vector<int32_t> validIndexes;
-    std::vector<QuadIndexes> quadIndexes;
-    std::unordered_map<GeoCoord, int32_t> geoCoordLookup;
-    std::vector<std::unordered_map<int32_t, WxAtGeoCoord>> wxResults;
+    std::vector<QuadIndexes> gridQuads;
+    std::vector<GeoCoord> coords;
+    WxColumns fields;
+    std::vector<PrecipitationType> types;
     
     fread(&numberOfFiles, sizeof(size_t), 1, f);
     fread(&len, sizeof(size_t), 1, f);
-    for(auto i = 0; i < len; i++)
-    {
-        fread(&int32Value, sizeof(int32_t), 1, f);
-        validIndexes.push_back(int32Value);
-    }
+    validIndexes.resize(len);
+    fread(validIndexes.data(), sizeof(int32_t), len, f);
+
+    //Everything after this is keyed by grid index, in whatever order the maps it was saved from were in.
+    unordered_map<int32_t, int32_t> pointAt;
+    pointAt.reserve(validIndexes.size());
+    for(size_t point = 0; point < validIndexes.size(); point++)
+        pointAt[validIndexes[point]] = static_cast<int32_t>(point);
 
     fread(&len, sizeof(size_t), 1, f);
-    for(auto i = 0; i < len; i++)
-    {
-        fread(&quadIndexValue, sizeof(QuadIndexes), 1, f);
-        quadIndexes.push_back(quadIndexValue);
-    }
+    gridQuads.resize(len);
+    fread(gridQuads.data(), sizeof(QuadIndexes), len, f);
 
+    coords.resize(validIndexes.size());
     fread(&len, sizeof(size_t), 1, f);
-    for(auto i = 0; i < len; i++)
+    for(size_t i = 0; i < len; i++)
     {
         fread(&geoCoordValue, sizeof(GeoCoord), 1, f);
         fread(&int32Value, sizeof(int32_t), 1, f);
-        geoCoordLookup[geoCoordValue] = int32Value;
+        coords[pointAt.at(int32Value)] = geoCoordValue;
     }
 
-    wxResults.resize(numberOfFiles);
-    for(auto i = 0; i < numberOfFiles; i++)
+    auto numberOfPoints = validIndexes.size();
+    for(auto field : wxFields)
+        fields[field].resize(numberOfFiles * numberOfPoints);
+
+    types.resize(numberOfFiles * numberOfPoints);
+    for(size_t file = 0; file < numberOfFiles; file++)
     {
-        auto& wxResult = wxResults[i];
         fread(&len, sizeof(size_t), 1, f);
-        for(auto k = 0; k < len; k++)
+        for(size_t k = 0; k < len; k++)
         {
             fread(&int32Value, sizeof(int32_t), 1, f);
             fread(&wxAtGeoCoordValue, sizeof(WxAtGeoCoord), 1, f);        
-            wxResult[int32Value] = wxAtGeoCoordValue;
+
+            auto& wx = wxAtGeoCoordValue.wx;
+            auto at = file * numberOfPoints + pointAt.at(int32Value);
+            types[at] = wx.type;
+
+            #define WRITE_WX_FIELD(property, field) fields[GribField::field][at] = static_cast<float>(wx.property);
+            FOR_EACH_WX_FIELD(WRITE_WX_FIELD)
+            #undef WRITE_WX_FIELD
         }
     }
 
-    fclose(f);
+    auto quadIndexes = ToPointQuads(validIndexes, gridQuads);
+    return new GribData(numberOfFiles, std::move(validIndexes), std::move(coords), std::move(quadIndexes), std::move(fields), std::move(types));
+}
+
+GribData* GribData::Append(const GribData& earlier, const GribData& later)
+{
+    if(earlier.gridHash != later.gridHash || earlier.validIndexes.size() != later.validIndexes.size())
+        ERR_OUT("Hours can only be appended to GribData read over the same points.");
+
+    //A column only one side has is filled out with zeros on the other, same as reading it back out of a Wx would give.
+    auto earlierSize = earlier.numberOfFiles * earlier.validIndexes.size(), laterSize = later.numberOfFiles * later.validIndexes.size();
+    auto appendColumn = [&](const auto& earlierColumn, const auto& laterColumn, auto& column) {
+        if(earlierColumn.empty() && laterColumn.empty())
+            return;
+
+        column.assign(earlierColumn.begin(), earlierColumn.end());
+        column.resize(earlierSize);
+        column.insert(column.end(), laterColumn.begin(), laterColumn.end());
+        column.resize(earlierSize + laterSize);
+    };
+
+    WxColumns fields;
+    for(auto field : wxFields)
+        appendColumn(earlier.fields[field], later.fields[field], fields[field]);
+
+    vector<PrecipitationType> types;
+    appendColumn(earlier.types, later.types, types);
+
+    //Either side can be empty when none of its hours were filled in, so both are padded out to their number of files first.
+    vector<uint8_t> interpolatedFiles;
+    if(!earlier.interpolatedFiles.empty() || !later.interpolatedFiles.empty())
+    {
+        interpolatedFiles.assign(earlier.interpolatedFiles.begin(), earlier.interpolatedFiles.end());
+        interpolatedFiles.resize(earlier.numberOfFiles, false);
+        interpolatedFiles.insert(interpolatedFiles.end(), later.interpolatedFiles.begin(), later.interpolatedFiles.end());
+        interpolatedFiles.resize(earlier.numberOfFiles + later.numberOfFiles, false);
+    }
+
+    vector<EnsembleStats> ensembleStats;
+    if(!earlier.ensembleStats.empty() && !later.ensembleStats.empty())
+    {
+        ensembleStats.assign(earlier.ensembleStats.begin(), earlier.ensembleStats.end());
+        ensembleStats.insert(ensembleStats.end(), later.ensembleStats.begin(), later.ensembleStats.end());
+    }
 
-    return new GribData(validIndexes, quadIndexes, geoCoordLookup, wxResults);
+    vector<int32_t> validIndexes(earlier.validIndexes.begin(), earlier.validIndexes.end());
+    vector<GeoCoord> coords(earlier.coords.begin(), earlier.coords.end());
+    vector<QuadIndexes> quadIndexes(earlier.quadIndexes.begin(), earlier.quadIndexes.end());
+    return new GribData(earlier.numberOfFiles + later.numberOfFiles, std::move(validIndexes), std::move(coords), std::move(quadIndexes), std::move(fields), std::move(types), std::move(interpolatedFiles), std::move(ensembleStats));
 }
\ No newline at end of file
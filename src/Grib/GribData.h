@@ -1,105 +1,206 @@
 #pragma once
+#include "EnsembleReduction.h"
 #include "Geography/Geo.h"
 #include "Wx.h"
 
 
+#include <array>
+#include <cstdio>
 #include <filesystem>
-#include <unordered_map>
+#include <memory>
+#include <span>
 #include <vector>
 
+//How a point's wx was laid out in gribdata.bin, one per point per file.
 struct WxAtGeoCoord {
     GeoCoord coord;
     Wx wx;
 };
 
+//Grid indexes coming out of the reader, and point ids once they're in GribData.
 struct QuadIndexes {
     int32_t topLeft, topRight, bottomLeft, bottomRight;
 };
 
+//Each column GribData keeps, along with the Wx member it's read back out into.
+#define FOR_EACH_WX_FIELD(WxField) \
+    WxField(precipitationRate, PrecipitationRateField) \
+    WxField(totalPrecipitation, TotalPrecipitationField) \
+    WxField(newPrecipitation, NewPrecipitationField) \
+    WxField(snowDepth, SnowDepthField) \
+    WxField(totalSnow, TotalSnowField) \
+    WxField(dewpoint, DewpointField) \
+    WxField(temperature, TemperatureField) \
+    WxField(totalCloudCover, TotalCloudCoverField) \
+    WxField(visibility, VisibilityField) \
+    WxField(windSpeed, WindSpeedField) \
+    WxField(gust, GustField) \
+    WxField(windU, WindUField) \
+    WxField(windV, WindVField) \
+    WxField(pressure, PressureField) \
+    WxField(lightning, LightningField)
+
+#define WX_FIELD_LIST_ITEM(property, field) GribField::field,
+inline constexpr GribField wxFields[] = { FOR_EACH_WX_FIELD(WX_FIELD_LIST_ITEM) };
+#undef WX_FIELD_LIST_ITEM
+
+//Every point in the region gets an id, its place in validIndexes, and everything about it is stored in plain arrays by that id.
+//Each field is a column of its own, by GribField, a file at a time, numberOfPoints long each, so a pass over one field never
+//drags the rest through the cache. Columns are floats, which is plenty for any of them once they're out of GRIB units.
+//The arrays are either the vectors it was built with, or straight out of a mapped gribdata.bin, which is laid out the same way.
 class GribData {
-private:    
-    const static WxAtGeoCoord emptyWx;
+public:
+    typedef std::array<std::vector<float>, GribFieldCount> WxColumns;
+
+private:
+    //What everything below points into when it wasn't loaded from a mapping.
+    struct OwnedData {
+        std::vector<int32_t> validIndexes;
+        std::vector<GeoCoord> coords;
+        std::vector<QuadIndexes> quadIndexes;
+        WxColumns fields;
+        std::vector<PrecipitationType> types;
+        std::vector<uint8_t> interpolatedFiles;
+        std::vector<EnsembleStats> ensembleStats;
+    };
 
-    const size_t numberOfFiles;
-    const std::vector<int32_t> validIndexes;
-    const std::vector<QuadIndexes> quadIndexes;
-    const std::unordered_map<GeoCoord, int32_t> geoCoordLookup;
-    const std::vector<std::unordered_map<int32_t, WxAtGeoCoord>> wxResults;
+    std::unique_ptr<OwnedData> owned;
+    void* mapping = nullptr;
+    size_t mappingLength = 0;
+
+    //Really one per forecast step, which is a file for hourly data, and a quarter of one for sub-hourly. The step's time is in the forecast repo.
+    size_t numberOfFiles = 0;
+    //Of validIndexes and coords, so two GribData over the same points can be told apart from ones that aren't without comparing them.
+    uint64_t gridHash = 0;
+    //Each point's index in the model's grid.
+    std::span<const int32_t> validIndexes;
+    std::span<const GeoCoord> coords;
+    std::span<const QuadIndexes> quadIndexes;
+    //Empty for a field that isn't in FOR_EACH_WX_FIELD, or that none of the files had.
+    std::array<std::span<const float>, GribFieldCount> fields;
+    //Laid out like a column. Empty when none of the files had a precipitation type.
+    std::span<const PrecipitationType> types;
+    //One per file, true if the hour wasn't downloaded and was filled in from the hours around it. Empty if none were.
+    std::span<const uint8_t> interpolatedFiles;
+    //Laid out like a column when this came out of an ensemble, whose wx is then the members' median. Empty otherwise.
+    std::span<const EnsembleStats> ensembleStats;
+
+    GribData() = default;
+
+    static uint64_t HashGrid(std::span<const int32_t> validIndexes, std::span<const GeoCoord> coords);
+    static GribData* LoadLegacy(FILE* f);
+    static GribData* LoadMapped(const std::filesystem::path& path);
+
+    inline size_t At(int32_t point, int32_t fileIndex) const { return static_cast<size_t>(fileIndex) * validIndexes.size() + point; }
 
 public:
-    GribData(std::vector<int32_t>& validIndexes, const std::vector<QuadIndexes>& quadIndexes, std::unordered_map<GeoCoord, int32_t>& geoCoordLookup, std::vector<std::unordered_map<int32_t, WxAtGeoCoord>>& wxResults) 
-        : numberOfFiles(wxResults.size()), validIndexes(validIndexes), quadIndexes(quadIndexes), geoCoordLookup(geoCoordLookup), wxResults(wxResults) {}
+    //quadIndexes are by point id, see ToPointQuads. Every column holds every point for the first file, then the next.
+    GribData(size_t numberOfFiles, std::vector<int32_t> validIndexes, std::vector<GeoCoord> coords, std::vector<QuadIndexes> quadIndexes, WxColumns fields, std::vector<PrecipitationType> types, 
+        std::vector<uint8_t> interpolatedFiles = {}, std::vector<EnsembleStats> ensembleStats = {});
+    GribData(const GribData&) = delete;
+    GribData& operator=(const GribData&) = delete;
+    ~GribData();
+
+    //Quads of grid indexes over to the ids of the points at their corners.
+    static std::vector<QuadIndexes> ToPointQuads(const std::vector<int32_t>& validIndexes, const std::vector<QuadIndexes>& gridQuads);
 
     inline size_t GetNumberOfFiles() { return numberOfFiles; }
-    inline const WxAtGeoCoord& GetWxAtGeoCoord(const GeoCoord& geoCoord, int32_t fileIndex)
+    inline size_t GetNumberOfPoints() { return validIndexes.size(); }
+    inline bool IsInterpolated(int32_t fileIndex) { return fileIndex >= 0 && static_cast<size_t>(fileIndex) < interpolatedFiles.size() && interpolatedFiles[fileIndex]; }
+
+    inline const GeoCoord& GetCoord(int32_t point) { return coords[point]; }
+    //Each point's index in the model's grid, by point id.
+    inline std::span<const int32_t> GetValidIndexes() { return validIndexes; }
+
+    //Every point's value of field for the file, by point id. Empty if the field wasn't kept.
+    inline std::span<const float> GetField(GribField field, int32_t fileIndex)
+    {
+        auto column = fields[field];
+        return column.empty() ? column : column.subspan(At(0, fileIndex), validIndexes.size());
+    }
+
+    //Same as GetField, for the precipitation types.
+    inline std::span<const PrecipitationType> GetTypes(int32_t fileIndex)
+    {
+        return types.empty() ? types : types.subspan(At(0, fileIndex), validIndexes.size());
+    }
+
+    //0 when the field wasn't kept.
+    inline double GetValue(GribField field, int32_t point, int32_t fileIndex)
+    {
+        auto column = fields[field];
+        return column.empty() ? 0 : column[At(point, fileIndex)];
+    }
+
+    //Every field of the point at once, for the places that use most of them.
+    inline Wx GetWx(int32_t point, int32_t fileIndex)
     {
-        if(fileIndex < 0 || fileIndex >= numberOfFiles)
-            return emptyWx;
+        Wx wx = {};
+        auto at = At(point, fileIndex);
+        if(!types.empty())
+            wx.type = types[at];
+
+        #define READ_WX_FIELD(property, field) if(!fields[GribField::field].empty()) wx.property = fields[GribField::field][at];
+        FOR_EACH_WX_FIELD(READ_WX_FIELD)
+        #undef READ_WX_FIELD
 
-        auto indexItr = geoCoordLookup.find(geoCoord);
-        if(indexItr == geoCoordLookup.end())
-            return emptyWx;
+        return wx;
+    }
+
+    inline bool IsEnsemble() { return !ensembleStats.empty(); }
+    //Null if this isn't an ensemble.
+    inline const EnsembleStats* GetEnsembleStats(int32_t point, int32_t fileIndex)
+    {
+        if(ensembleStats.empty() || fileIndex < 0 || static_cast<size_t>(fileIndex) >= numberOfFiles)
+            return nullptr;
 
-        return wxResults[fileIndex].find(indexItr->second)->second;
+        return &ensembleStats[At(point, fileIndex)];
     }
 
-    std::vector<GeoCoord> GetGeoCoords();
-    const std::vector<QuadIndexes>& GetQuadIndexes() { return quadIndexes; }
+    //By point id, the same ids an IGeoPointSet made from them hands back.
+    inline std::span<const GeoCoord> GetGeoCoords() { return coords; }
+    std::span<const QuadIndexes> GetQuadIndexes() { return quadIndexes; }
 
+    //Always in the mapped format, see GribDataHeader in GribData.cpp.
     void Save(std::filesystem::path path);
+    //Maps the file when it's in the mapped format, and reads the whole thing in when it's from before there was one.
     static GribData* Load(std::filesystem::path path);
+    //later's hours after earlier's, which both have to have been read over the same points.
+    static GribData* Append(const GribData& earlier, const GribData& later);
+
+    //One corner of a quad. Its values are in whichever columns are wanted, by point.
+    struct QuadCorner {
+        int32_t point;
+        const GeoCoord& coord;
+    };
 
     struct Quad {
-        WxAtGeoCoord topLeft, topRight, bottomLeft, bottomRight;
+        QuadCorner topLeft, topRight, bottomLeft, bottomRight;
     };
 
     class QuadIterator {
     private:
-        const int32_t fileIndex;
-        const std::unordered_map<int32_t, WxAtGeoCoord>& wxResult;
-        std::vector<QuadIndexes>::const_iterator currentQuadItr;
-        std::vector<QuadIndexes>::const_iterator quadItrEnd;
-        Quad currentQuad;
-
-        void UpdateCurrentQuad()
-        {
-            if(currentQuadItr != quadItrEnd)
-            {
-                auto& currentQuadIndexes = *currentQuadItr;
-                currentQuad = {
-                    .topLeft = wxResult.find(currentQuadIndexes.topLeft)->second,
-                    .topRight = wxResult.find(currentQuadIndexes.topRight)->second,
-                    .bottomLeft = wxResult.find(currentQuadIndexes.bottomLeft)->second,
-                    .bottomRight = wxResult.find(currentQuadIndexes.bottomRight)->second
-                };
-            }
-            else
-                currentQuad = {emptyWx, emptyWx, emptyWx, emptyWx};
-        }
+        const GeoCoord* coords;
+        const QuadIndexes* currentQuadItr;
+
+        inline QuadCorner Corner(int32_t point) const { return { point, coords[point] }; }
 
     public:
         using iterator_category = std::forward_iterator_tag;
         using value_type = Quad;
-        using pointer = const value_type*;
-        using reference = const value_type&;
+        using reference = Quad;
         using difference_type = ptrdiff_t;
 
-        inline QuadIterator(int32_t fileIndex, const std::unordered_map<int32_t, WxAtGeoCoord>& wxResult, std::vector<QuadIndexes>::const_iterator itr, std::vector<QuadIndexes>::const_iterator itrEnd)
-            : fileIndex(fileIndex), wxResult(wxResult), currentQuadItr(itr), currentQuad({emptyWx, emptyWx, emptyWx, emptyWx}), quadItrEnd(itrEnd)
-            {
-                UpdateCurrentQuad();
-            }
-
-        inline reference operator*() const {
-            return currentQuad;
-        }
+        inline QuadIterator(const GeoCoord* coords, const QuadIndexes* itr) : coords(coords), currentQuadItr(itr) {}
 
-        inline pointer operator->() const {
-            return &currentQuad;
+        //Built on the spot, but it's only ids and references.
+        inline Quad operator*() const {
+            auto& quad = *currentQuadItr;
+            return { Corner(quad.topLeft), Corner(quad.topRight), Corner(quad.bottomLeft), Corner(quad.bottomRight) };
         }
 
         inline friend bool operator==(const QuadIterator& lhs, const QuadIterator& rhs) {
-            return lhs.fileIndex == rhs.fileIndex && lhs.currentQuadItr == rhs.currentQuadItr;
+            return lhs.currentQuadItr == rhs.currentQuadItr;
         }
 
         inline friend bool operator!=(const QuadIterator& lhs, const QuadIterator& rhs) {
@@ -108,36 +209,34 @@ public:
 
         inline QuadIterator& operator++() {
             currentQuadItr++;
-            UpdateCurrentQuad();
             return *this;
         }
 
         inline QuadIterator operator++(int) {
             auto result = *this;
             currentQuadItr++;
-            UpdateCurrentQuad();
             return result;
         }
     };
 
-    class GribDataFileQuads {
+    class GribDataQuads {
         private:
-            int32_t fileIndex;
             GribData* parent;
 
         public:
-            GribDataFileQuads(GribData* parent, int32_t fileIndex) : parent(parent), fileIndex(fileIndex) {}
+            GribDataQuads(GribData* parent) : parent(parent) {}
 
         inline QuadIterator begin() const {
-            return QuadIterator(fileIndex, parent->wxResults[fileIndex], parent->quadIndexes.begin(), parent->quadIndexes.end());
+            return QuadIterator(parent->coords.data(), parent->quadIndexes.data());
         }
 
         inline QuadIterator end() const {
-            return QuadIterator(fileIndex, parent->wxResults[fileIndex], parent->quadIndexes.end(), parent->quadIndexes.end());
+            return QuadIterator(parent->coords.data(), parent->quadIndexes.data() + parent->quadIndexes.size());
         }
     };
 
-    inline GribDataFileQuads GetQuadIteratorForFileIndex(int32_t fileIndex) {
-        return GribDataFileQuads(this, fileIndex);
+    //The same quads for every file. Pair them up with GetField for a file's values.
+    inline GribDataQuads GetQuads() {
+        return GribDataQuads(this);
     }
 };
\ No newline at end of file
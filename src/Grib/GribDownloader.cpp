@@ -2,10 +2,14 @@
 #include "Error.h"
 #include "Geography/Geo.h"
 #include "GribDownloader.h"
+#include "GribInventory.h"
 #include "HttpClient.h"
 #include <filesystem>
+#include <functional>
 #include <omp.h>
 #include <sstream>
+#include <thread>
+#include <unistd.h>
 
 namespace fs = std::filesystem;
 using namespace std;
@@ -25,13 +29,21 @@ time_t GetStartTimeForWeatherModelDownload(WeatherModel weatherModel)
 
     if(weatherModel == WeatherModel::HRRR && sinceHourDivisibleBy6 < (secondsInHour + (55 * secondsInMinute)))
         now -= secondsInHour * 6;
-    else if(weatherModel == WeatherModel::GFS && sinceHourDivisibleBy6 < ((secondsInHour * 5) + (55 * secondsInMinute)))
+    else if((weatherModel == WeatherModel::GFS || weatherModel == WeatherModel::GEFS) && sinceHourDivisibleBy6 < ((secondsInHour * 5) + (55 * secondsInMinute)))
         now -= secondsInHour * 6;
 
     return now;
 }
 
-string GetFilePathTemplate(string outputDirectory, WeatherModel weatherModel)
+//GEFS member 0 is the control run (gec00), the rest are the perturbed runs (gep01 on up).
+inline string GetEnsembleMemberName(int32_t member)
+{
+    stringstream name;
+    name << (member ? "gep" : "gec") << setfill('0') << setw(2) << member;
+    return name.str();
+}
+
+string GetFilePathTemplate(string outputDirectory, WeatherModel weatherModel, int32_t member = 0)
 {
     switch(weatherModel)
     {
@@ -39,20 +51,31 @@ string GetFilePathTemplate(string outputDirectory, WeatherModel weatherModel)
             return fs::path(outputDirectory) / string("hrrr-%02d.grib2");
         case WeatherModel::GFS:
             return fs::path(outputDirectory) / string("gfs-%03d.grib2");
+        case WeatherModel::GEFS:
+            return fs::path(outputDirectory) / ("gefs-" + GetEnsembleMemberName(member) + "-%03d.grib2");
         default:
             ERR_OUT("Unsupported WeatherModel")
     }
 }
 
-string GetUrlForWeatherModel(const GeoBounds& geoBounds, WeatherModel weatherModel, int32_t hour, int32_t forecastIndex, const char* timeStamp)
+//The run's date, as it is in NOMADS' paths, and the rest of its start time in forecastStart.
+inline void GetRunTimeStamp(time_t forecastStartTime, char (&timeStamp)[9], tm& forecastStart)
+{
+    gmtime_r(&forecastStartTime, &forecastStart);
+    strftime(timeStamp, sizeof(timeStamp), "%Y%m%d", &forecastStart);
+}
+
+inline const char* GetHRRRProduct(bool subHourly) { return subHourly ? "z.wrfsubhf" : "z.wrfsfcf"; }
+
+string GetUrlForWeatherModel(const GeoBounds& geoBounds, WeatherModel weatherModel, int32_t hour, int32_t forecastIndex, const char* timeStamp, int32_t member, bool subHourly)
 {
     stringstream urlStream;
     urlStream.precision(6);
     if(weatherModel == WeatherModel::HRRR)
     {
-        urlStream << "https://nomads.ncep.noaa.gov/cgi-bin/filter_hrrr_2d.pl?file=hrrr.t" <<
+        urlStream << "https://nomads.ncep.noaa.gov/cgi-bin/" << (subHourly ? "filter_hrrr_sub.pl" : "filter_hrrr_2d.pl") << "?file=hrrr.t" <<
             setfill('0') << setw(2) << hour <<
-            "z.wrfsfcf" <<
+            GetHRRRProduct(subHourly) <<
             setfill('0') << setw(2) << forecastIndex <<
             ".grib2&all_lev=on&all_var=on&subregion=&leftlon=" << fixed << geoBounds.leftLon << 
             "&rightlon="  << geoBounds.rightLon << 
@@ -72,6 +95,47 @@ string GetUrlForWeatherModel(const GeoBounds& geoBounds, WeatherModel weatherMod
             "&dir=%2Fgfs."<< timeStamp <<
             "%2F" << setfill('0') << setw(2) << hour << "%2Fatmos";
     }
+    else if(weatherModel == WeatherModel::GEFS)
+    {
+        urlStream << "https://nomads.ncep.noaa.gov/cgi-bin/filter_gefs_atmos_0p50a.pl?file=" << GetEnsembleMemberName(member) << ".t" <<
+            setfill('0') << setw(2) << hour << "z.pgrb2a.0p50.f" <<
+            setfill('0') << setw(3) << forecastIndex <<
+            "&lev_10_m_above_ground=on&lev_2_m_above_ground=on&lev_entire_atmosphere=on&lev_mean_sea_level=on&lev_surface=on&all_var=on&subregion=&leftlon=" << fixed << geoBounds.leftLon << 
+            "&rightlon=" << geoBounds.rightLon << 
+            "&toplat=" << geoBounds.topLat <<
+            "&bottomlat=" << geoBounds.bottomLat << 
+            "&dir=%2Fgefs."<< timeStamp <<
+            "%2F" << setfill('0') << setw(2) << hour << "%2Fatmos%2Fpgrb2ap5";
+    }
+
+    return urlStream.str();
+}
+
+//The whole, unfiltered file. Its .idx is at the same url with .idx on the end.
+string GetGribFileUrlForWeatherModel(WeatherModel weatherModel, int32_t hour, int32_t forecastIndex, const char* timeStamp, int32_t member, bool subHourly)
+{
+    stringstream urlStream;
+    if(weatherModel == WeatherModel::HRRR)
+    {
+        urlStream << "https://nomads.ncep.noaa.gov/pub/data/nccf/com/hrrr/prod/hrrr." << timeStamp << "/conus/hrrr.t" <<
+            setfill('0') << setw(2) << hour <<
+            GetHRRRProduct(subHourly) <<
+            setfill('0') << setw(2) << forecastIndex << ".grib2";
+    }
+    else if(weatherModel == WeatherModel::GFS)
+    {
+        urlStream << "https://nomads.ncep.noaa.gov/pub/data/nccf/com/gfs/prod/gfs." << timeStamp << "/" <<
+            setfill('0') << setw(2) << hour << "/atmos/gfs.t" <<
+            setfill('0') << setw(2) << hour << "z.pgrb2.0p25.f" <<
+            setfill('0') << setw(3) << forecastIndex;
+    }
+    else if(weatherModel == WeatherModel::GEFS)
+    {
+        urlStream << "https://nomads.ncep.noaa.gov/pub/data/nccf/com/gens/prod/gefs." << timeStamp << "/" <<
+            setfill('0') << setw(2) << hour << "/atmos/pgrb2ap5/" << GetEnsembleMemberName(member) << ".t" <<
+            setfill('0') << setw(2) << hour << "z.pgrb2a.0p50.f" <<
+            setfill('0') << setw(3) << forecastIndex;
+    }
 
     return urlStream.str();
 }
@@ -113,7 +177,7 @@ bool LoadDownloadInfo(fs::path outputDirectory, SaveData& saveData, bool exitOnN
 }
 
 GribDownloader::GribDownloader(const SelectedRegion& selectedRegion, string outputDirectory)
-    : selectedRegion(selectedRegion), usingCachedMode(true)
+    : selectedRegion(selectedRegion), ensembleMembers(0), usingCachedMode(true), downloadModes(GribDownloadModes::DefaultGribDownloadMode), outputDirectory(outputDirectory)
 {
     SaveData saveData = {0};
     LoadDownloadInfo(outputDirectory, saveData, true);
@@ -122,8 +186,8 @@ GribDownloader::GribDownloader(const SelectedRegion& selectedRegion, string outp
     filePathTemplate = ::GetFilePathTemplate(outputDirectory, saveData.weatherModel);
 }
 
-GribDownloader::GribDownloader(const SelectedRegion& selectedRegion, string outputDirectory, WeatherModel weatherModel, uint16_t maxGribIndex, uint16_t skipToGribNumber)
-    :  selectedRegion(selectedRegion), maxGribIndex(maxGribIndex), skipToGribNumber(skipToGribNumber), usingCachedMode(false), weatherModel(weatherModel), forecastStartTime(GetStartTimeForWeatherModelDownload(weatherModel)), outputDirectory(outputDirectory)
+GribDownloader::GribDownloader(const SelectedRegion& selectedRegion, string outputDirectory, WeatherModel weatherModel, uint16_t maxGribIndex, uint16_t skipToGribNumber, GribDownloadModes downloadModes, vector<ForecastHourStride> hourStrides, uint16_t ensembleMembers)
+    :  selectedRegion(selectedRegion), maxGribIndex(maxGribIndex), skipToGribNumber(skipToGribNumber), hourStrides(hourStrides), ensembleMembers(weatherModel == WeatherModel::GEFS ? ensembleMembers : 0), usingCachedMode(false), downloadModes(downloadModes), weatherModel(weatherModel), forecastStartTime(GetStartTimeForWeatherModelDownload(weatherModel)), outputDirectory(outputDirectory)
 {
     filePathTemplate = ::GetFilePathTemplate(outputDirectory, weatherModel);
     
@@ -139,51 +203,223 @@ void GribDownloader::Init(void* vSaveData)
     skipToGribNumber = saveData->skipToGribNumber;
     weatherModel = saveData->weatherModel;
 
-    cout << "Loaded the " << (weatherModel == WeatherModel::GFS ? "GFS" : "HRRR") << " from cache..." << endl;
+    cout << "Loaded the " << GetWeatherModelName(weatherModel) << " from cache..." << endl;
 }
 
-void GribDownloader::Download()
+bool GribDownloader::UseCacheIfCurrent()
 {
     if(usingCachedMode)
-        return;
+        return true;
 
     SaveData saveData = {0};
-    if(LoadDownloadInfo(outputDirectory, saveData, false) && saveData.time == forecastStartTime)
+    //A run that's still being published is downloaded a few hours at a time, so the same start time isn't enough on its own.
+    if(LoadDownloadInfo(outputDirectory, saveData, false) && saveData.time == forecastStartTime && saveData.skipToGribNumber <= skipToGribNumber && saveData.maxGribIndex >= maxGribIndex)
     {
         cout << "Would download the same data already cached. Loading that, and continuing..." << endl;
         Init(static_cast<void*>(&saveData));
         usingCachedMode = true;
-        return;
+        return true;
+    }
+
+    return false;
+}
+
+void GribDownloader::DownloadByteRanges(const string& url, string& grib)
+{
+    int32_t totalMessages = 0, wantedMessages = 0;
+    size_t rangeCount = 0;
+    auto bytesDownloaded = DownloadWantedMessages(url, weatherModel, grib, totalMessages, wantedMessages, rangeCount);
+
+    #pragma omp critical
+    cout << "Thread " << omp_get_thread_num() << ": Kept " << wantedMessages << " of " << totalMessages << " messages in " << rangeCount << " ranges, " 
+        << (bytesDownloaded / 1024) << " KB from " << url << endl;
+}
+
+vector<string> GribDownloader::GetMemberFilePathTemplates()
+{
+    vector<string> templates;
+    for(auto member = 0; member <= ensembleMembers; member++)
+        templates.push_back(::GetFilePathTemplate(outputDirectory, weatherModel, member));
+
+    return templates;
+}
+
+//The first and last hours are always wanted, so there's something on both sides of every hour that gets skipped.
+bool GribDownloader::IsForecastHourWanted(uint16_t hour)
+{
+    if(!IsForecastHourPublished(weatherModel, hour))
+        return false;
+
+    if(hour == skipToGribNumber || hour == maxGribIndex)
+        return true;
+
+    const ForecastHourStride* band = nullptr;
+    for(auto& hourStride : hourStrides)
+    {
+        if(hourStride.fromHour <= hour && (!band || hourStride.fromHour >= band->fromHour))
+            band = &hourStride;
     }
 
+    return !band || band->stride <= 1 || (hour - band->fromHour) % band->stride == 0;
+}
+
+//NOAA puts a run's hours up in order, so the first one without an .idx is as far as it's gotten.
+bool GribDownloader::LimitToPublishedHours()
+{
     char timeStamp[9] = {0};
     tm forecastStart = {0};
-    gmtime_r(&forecastStartTime, &forecastStart);
-    strftime(timeStamp, 9, "%Y%m%d", &forecastStart);
+    GetRunTimeStamp(forecastStartTime, timeStamp, forecastStart);
+
+    auto subHourly = (downloadModes & SubHourlyGribDownloadMode) == SubHourlyGribDownloadMode;
+    int32_t lastPublished = -1;
+    for(uint32_t i = skipToGribNumber; i <= maxGribIndex; i++)
+    {
+        if(!IsForecastHourPublished(weatherModel, i))
+            continue;
+
+        auto url = GetGribFileUrlForWeatherModel(weatherModel, forecastStart.tm_hour, i, timeStamp, 0, subHourly) + ".idx";
+        if(!HttpClient::Exists(url.c_str()))
+            break;
+
+        lastPublished = i;
+    }
+
+    if(lastPublished < skipToGribNumber)
+    {
+        cout << "The " << GetWeatherModelName(weatherModel) << " run from " << timeStamp << " at hour " << forecastStart.tm_hour << " doesn't have hour " << skipToGribNumber << " up yet." << endl;
+        return false;
+    }
+
+    cout << "The " << GetWeatherModelName(weatherModel) << " run is up through hour " << lastPublished << "." << endl;
+    maxGribIndex = static_cast<uint16_t>(lastPublished);
+    return true;
+}
+
+void GribDownloader::DownloadAll(uint16_t downloadThreads, GribBufferPool* bufferPool, BoundedQueue<GribBuffer*>* archiveQueue, function<void (LandedGrib landed)> onGribLanded)
+{
+    char timeStamp[9] = {0};
+    tm forecastStart = {0};
+    GetRunTimeStamp(forecastStartTime, timeStamp, forecastStart);
 
-    cout << "Downloading the " << (weatherModel == WeatherModel::GFS ? "GFS" : "HRRR") << " model with timestamp " << timeStamp << " at hour " << forecastStart.tm_hour << "..." << endl;
+    cout << "Downloading the " << GetWeatherModelName(weatherModel) << " model with timestamp " << timeStamp << " at hour " << forecastStart.tm_hour << "..." << endl;
+
+    //Ensemble members all go to disk, under templates of their own, since a LandedGrib only knows its hour.
+    auto memberTemplates = GetMemberFilePathTemplates();
+    if(memberTemplates.size() > 1 && (bufferPool || onGribLanded))
+        ERR_OUT("Ensembles can only be downloaded straight to disk.");
 
     auto geoBounds = selectedRegion.GetForecastAreaBounds();
-    #pragma omp parallel for num_threads(3)
-    for(uint32_t i = skipToGribNumber; i <= maxGribIndex; i++)
+    uint32_t hoursPerMember = maxGribIndex - skipToGribNumber + 1;
+    #pragma omp parallel for schedule(dynamic) num_threads(downloadThreads)
+    for(uint32_t job = 0; job < memberTemplates.size() * hoursPerMember; job++)
     {
-        if(weatherModel == WeatherModel::GFS && i > 120 && i % 3 != 0)
+        auto member = static_cast<int32_t>(job / hoursPerMember);
+        uint32_t i = skipToGribNumber + job % hoursPerMember;
+        //An hour that's skipped now might have been downloaded by an earlier run, and the reader takes whatever's in the directory.
+        if(!IsForecastHourWanted(static_cast<uint16_t>(i)))
+        {
+            char stalefilename[FILENAME_MAX] = {0};
+            snprintf(stalefilename, FILENAME_MAX, memberTemplates[member].c_str(), i);
+            error_code ignored;
+            fs::remove(stalefilename, ignored);
             continue;
+        }
 
-        auto url = GetUrlForWeatherModel(geoBounds, weatherModel, forecastStart.tm_hour, i, timeStamp);
+        auto byteRanges = (downloadModes & ByteRangeGribDownloadMode) == ByteRangeGribDownloadMode;
+        auto subHourly = (downloadModes & SubHourlyGribDownloadMode) == SubHourlyGribDownloadMode;
+        auto url = byteRanges ? GetGribFileUrlForWeatherModel(weatherModel, forecastStart.tm_hour, i, timeStamp, member, subHourly) : GetUrlForWeatherModel(geoBounds, weatherModel, forecastStart.tm_hour, i, timeStamp, member, subHourly);
         cout << "Thread " << omp_get_thread_num() << ": Downloading " << url << endl;
+
+        if(bufferPool)
+        {
+            auto buffer = bufferPool->Take(static_cast<uint16_t>(i), archiveQueue ? 2 : 1);
+            if(byteRanges)
+                DownloadByteRanges(url, buffer->bytes);
+            else
+                HttpClient::Get(url.c_str(), buffer->bytes);
+
+            if(archiveQueue)
+                archiveQueue->Push(buffer);
+
+            onGribLanded({ static_cast<uint16_t>(i), buffer });
+            continue;
+        }
+
         char outfilename[FILENAME_MAX] = {0};
-        snprintf(outfilename, FILENAME_MAX, filePathTemplate.c_str(), i);
+        snprintf(outfilename, FILENAME_MAX, memberTemplates[member].c_str(), i);
         auto fp = fopen(outfilename, "wb");
         if(!fp)
             ERR_OUT("Unable to to open " << outfilename);
 
-        HttpClient::Get(url.c_str(), fwrite, fp);
+        if(byteRanges)
+        {
+            string grib;
+            DownloadByteRanges(url, grib);
+            fwrite(grib.data(), 1, grib.size(), fp);
+        }
+        else
+            HttpClient::Get(url.c_str(), fwrite, fp, [&]() { fflush(fp); ftruncate(fileno(fp), 0); rewind(fp); });
 
         fclose(fp);
+
+        if(onGribLanded)
+            onGribLanded({ static_cast<uint16_t>(i), nullptr });
     }
-    
-    SaveDownloadInfo(outputDirectory, weatherModel, maxGribIndex, skipToGribNumber, forecastStartTime);
 
     cout << "Downloads complete!" << endl;
+}
+
+void GribDownloader::ArchiveAll(BoundedQueue<GribBuffer*>& archiveQueue)
+{
+    GribBuffer* buffer = nullptr;
+    while(archiveQueue.Pop(buffer))
+    {
+        char outfilename[FILENAME_MAX] = {0};
+        snprintf(outfilename, FILENAME_MAX, filePathTemplate.c_str(), buffer->gribNumber);
+        auto fp = fopen(outfilename, "wb");
+        if(!fp)
+            ERR_OUT("Unable to to open " << outfilename);
+
+        fwrite(buffer->bytes.data(), 1, buffer->bytes.size(), fp);
+        fclose(fp);
+        buffer->Release();
+    }
+
+    cout << "Archiving complete!" << endl;
+}
+
+void GribDownloader::Download()
+{
+    if(UseCacheIfCurrent())
+        return;
+
+    DownloadAll(3, nullptr, nullptr, nullptr);
+    SaveDownloadInfo(outputDirectory, weatherModel, maxGribIndex, skipToGribNumber, forecastStartTime);
+}
+
+void GribDownloader::Download(BoundedQueue<LandedGrib>& landedGribs, uint16_t downloadThreads)
+{
+    DownloadAll(downloadThreads, nullptr, nullptr, [&](LandedGrib landed) { landedGribs.Push(landed); });
+    SaveDownloadInfo(outputDirectory, weatherModel, maxGribIndex, skipToGribNumber, forecastStartTime);
+    landedGribs.Close();
+}
+
+void GribDownloader::Download(BoundedQueue<LandedGrib>& landedGribs, uint16_t downloadThreads, GribBufferPool& bufferPool, bool archive)
+{
+    //Never more buffers out than the pool has, so this can't fill up on the downloads.
+    BoundedQueue<GribBuffer*> archiveQueue(bufferPool.GetSize());
+    thread archiver;
+    if(archive)
+        archiver = thread([&]() { ArchiveAll(archiveQueue); });
+
+    DownloadAll(downloadThreads, &bufferPool, archive ? &archiveQueue : nullptr, [&](LandedGrib landed) { landedGribs.Push(landed); });
+    landedGribs.Close();
+
+    //Without the files on disk there's nothing for a later run to use, so only say there's a cached download once they're all written.
+    if(archive)
+    {
+        archiveQueue.Close();
+        archiver.join();
+        SaveDownloadInfo(outputDirectory, weatherModel, maxGribIndex, skipToGribNumber, forecastStartTime);
+    }
 }
\ No newline at end of file
@@ -1,31 +1,72 @@
 #pragma once
 
+#include "BoundedQueue.h"
+#include "GribBuffer.h"
 #include "Grib.h"
 #include "Data/SelectedRegion.h"
 
+#include <functional>
 #include <string>
+#include <vector>
+
+enum GribDownloadModes {
+    DefaultGribDownloadMode = 0,
+    //Fetch the .idx for each hour and ask for just the messages GribReader uses, instead of going through the NOMADS filter.
+    ByteRangeGribDownloadMode = (1 << 0),
+    //HRRR only. The wrfsubhf files, with four 15 minute steps in each, instead of wrfsfcf.
+    SubHourlyGribDownloadMode = (1 << 1)
+};
+
+//From fromHour on, only every stride-th hour is downloaded, until the next one takes over. The reader fills in the rest.
+struct ForecastHourStride
+{
+    uint16_t fromHour, stride;
+};
+
+//The latest run of weatherModel that should be up on NOMADS by now.
+time_t GetStartTimeForWeatherModelDownload(WeatherModel weatherModel);
 
 class GribDownloader {
 private:
     uint16_t maxGribIndex, skipToGribNumber;
+    std::vector<ForecastHourStride> hourStrides;
+    //GEFS only, how many perturbed members to download along with the control.
+    uint16_t ensembleMembers;
     bool usingCachedMode;
+    GribDownloadModes downloadModes;
     WeatherModel weatherModel;
     time_t forecastStartTime;
     std::string filePathTemplate, outputDirectory;
     const SelectedRegion& selectedRegion;
 
     void Init(void* vSaveData);
+    bool IsForecastHourWanted(uint16_t hour);
+    void DownloadByteRanges(const std::string& url, std::string& grib);
+    //Without a bufferPool each hour is written to its file, and lands with no buffer. With one, it lands in memory, and goes to archiveQueue too if there is one.
+    void DownloadAll(uint16_t downloadThreads, GribBufferPool* bufferPool, BoundedQueue<GribBuffer*>* archiveQueue, std::function<void (LandedGrib landed)> onGribLanded);
+    void ArchiveAll(BoundedQueue<GribBuffer*>& archiveQueue);
 
 public:
     GribDownloader(const SelectedRegion& selectedRegion, std::string outputDirectory);
-    GribDownloader(const SelectedRegion& selectedRegion, std::string outputDirectory, WeatherModel weatherModel, uint16_t maxGribIndex, uint16_t skipToGribNumber = 0);
+    GribDownloader(const SelectedRegion& selectedRegion, std::string outputDirectory, WeatherModel weatherModel, uint16_t maxGribIndex, uint16_t skipToGribNumber = 0, GribDownloadModes downloadModes = DefaultGribDownloadMode, std::vector<ForecastHourStride> hourStrides = {}, uint16_t ensembleMembers = 0);
 
     std::string GetFilePathTemplate() {return filePathTemplate;}
+    //The control's first, which is the same as GetFilePathTemplate. Just that one when it isn't an ensemble.
+    std::vector<std::string> GetMemberFilePathTemplates();
     uint16_t GetMaxGribIndex() {return maxGribIndex;}
     uint16_t GetSkipToGribNumber() {return skipToGribNumber;}
     WeatherModel GetWeatherModel() {return weatherModel;}
     time_t GetForecastStartTime() {return forecastStartTime;}
 
     bool UsingCachedMode() { return usingCachedMode; }
+    //Pulls maxGribIndex back to the last hour NOAA has up so far. False when it doesn't have skipToGribNumber yet.
+    bool LimitToPublishedHours();
+    //Switches over to the cached download if it's for the same forecast start time, and has every hour asked for.
+    bool UseCacheIfCurrent();
     void Download();
+    //Pushes each hour as soon as its file is on disk, then closes the queue. Not for ensembles. Expects UseCacheIfCurrent to have already been checked.
+    void Download(BoundedQueue<LandedGrib>& landedGribs, uint16_t downloadThreads);
+    //Same, but each hour is pushed still in its buffer from bufferPool, with no trip through the disk. With archive the files are
+    //written out on a thread of their own, off of the decoder's path. Without it nothing is written, so there's nothing to use as a cache later.
+    void Download(BoundedQueue<LandedGrib>& landedGribs, uint16_t downloadThreads, GribBufferPool& bufferPool, bool archive);
 };
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include "GribInventory.h"
+#include "Error.h"
+#include "HttpClient.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <sstream>
+#include <string_view>
+#include <strings.h>
+
+using namespace std;
+
+struct InventoryField {
+    const char* variable;
+    const char* level;
+};
+
+//Every message ClassifyMessage turns into a GribField, by the names the .idx uses. Pulling in an extra message is harmless,
+//the reader skips it, but missing one drops a field, so when in doubt these err on the side of more.
+static const InventoryField hrrrInventoryFields[] = {
+    {"CRAIN", "surface"}, {"CFRZR", "surface"}, {"CSNOW", "surface"}, {"PRATE", "surface"}, {"APCP", "surface"},
+    {"SNOD", "surface"}, {"ASNOW", "surface"}, {"DPT", "2 m above ground"}, {"TMP", "2 m above ground"},
+    {"TCDC", "entire atmosphere"}, {"VIS", "surface"}, {"WIND", "10 m above ground"}, {"GUST", "surface"},
+    {"UGRD", "10 m above ground"}, {"VGRD", "10 m above ground"}, {"MSLMA", "mean sea level"}, {"LTNG", "entire atmosphere"}
+};
+
+//GFS matches on shortName "t" at whatever level, so TMP keeps every level the NOMADS filter used to ask for.
+static const char* gfsLevels[] = {
+    "10 m above ground", "20 m above ground", "2 m above ground", "entire atmosphere", "entire atmosphere (considered as a single layer)",
+    "mean sea level", "surface", "top of atmosphere"
+};
+
+static const char* gfsVariables[] = {
+    "CRAIN", "CFRZR", "CSNOW", "PRATE", "APCP", "SNOD", "ASNOW", "DPT", "TMP", "TCDC", "VIS", "GUST", "UGRD", "VGRD", "MSLET", "LTNG"
+};
+
+static const InventoryField gefsInventoryFields[] = {
+    {"CRAIN", "surface"}, {"CFRZR", "surface"}, {"CSNOW", "surface"}, {"PRATE", "surface"}, {"APCP", "surface"},
+    {"SNOD", "surface"}, {"TMP", "2 m above ground"}, {"TCDC", "entire atmosphere"}, {"UGRD", "10 m above ground"}, 
+    {"VGRD", "10 m above ground"}, {"PRMSL", "mean sea level"}
+};
+
+template <typename T, size_t N>
+inline bool Contains(const T (&values)[N], const string_view& value) { return find(begin(values), end(values), value) != end(values); }
+
+inline bool IsWantedField(WeatherModel weatherModel, const string_view& variable, const string_view& level)
+{
+    switch(weatherModel)
+    {
+        case WeatherModel::HRRR:
+            return any_of(begin(hrrrInventoryFields), end(hrrrInventoryFields), [&](const InventoryField& field) { return variable == field.variable && level == field.level; });
+        case WeatherModel::GFS:
+            return Contains(gfsVariables, variable) && Contains(gfsLevels, level);
+        case WeatherModel::GEFS:
+            return any_of(begin(gefsInventoryFields), end(gefsInventoryFields), [&](const InventoryField& field) { return variable == field.variable && level == field.level; });
+        default:
+            ERR_OUT("Unsupported WeatherModel")
+    }
+}
+
+vector<GribByteRange> GetByteRangesFromInventory(const string& inventory, WeatherModel weatherModel, int32_t& totalMessages, int32_t& wantedMessages)
+{
+    struct InventoryLine {
+        int64_t offset;
+        bool wanted;
+    };
+
+    vector<InventoryLine> lines;
+    istringstream stream(inventory);
+    string line;
+    while(getline(stream, line))
+    {
+        if(!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        if(line.empty())
+            continue;
+
+        //n:offset:d=date:VAR:level:forecast:
+        string_view fields[6];
+        size_t start = 0;
+        auto fieldCount = 0;
+        while(fieldCount < 6)
+        {
+            auto colon = line.find(':', start);
+            fields[fieldCount++] = string_view(line).substr(start, colon == string::npos ? string::npos : colon - start);
+            if(colon == string::npos)
+                break;
+
+            start = colon + 1;
+        }
+
+        if(fieldCount < 5)
+            ERR_OUT("Unable to read inventory line: " << line);
+
+        lines.push_back({ strtoll(string(fields[1]).c_str(), nullptr, 10), IsWantedField(weatherModel, fields[3], fields[4]) });
+    }
+
+    //A message runs up to where the next one starts, and the last one runs to the end of the file.
+    vector<GribByteRange> ranges;
+    totalMessages = static_cast<int32_t>(lines.size());
+    wantedMessages = 0;
+    for(size_t i = 0; i < lines.size(); i++)
+    {
+        if(!lines[i].wanted)
+            continue;
+
+        wantedMessages++;
+        auto end = i + 1 < lines.size() ? lines[i + 1].offset - 1 : -1;
+        if(!ranges.empty() && ranges.back().end + 1 == lines[i].offset)
+            ranges.back().end = end;
+        else
+            ranges.push_back({ lines[i].offset, end });
+    }
+
+    return ranges;
+}
+
+string ToRangeHeader(vector<GribByteRange>::const_iterator begin, vector<GribByteRange>::const_iterator end)
+{
+    stringstream header;
+    for(auto itr = begin; itr != end; itr++)
+    {
+        if(itr != begin)
+            header << ",";
+
+        header << itr->start << "-";
+        if(itr->end != -1)
+            header << itr->end;
+    }
+
+    return header.str();
+}
+
+void AppendByteRangeResponse(string& grib, const string& url, long httpCode, const string& contentType, const string& body,
+    vector<GribByteRange>::const_iterator begin, vector<GribByteRange>::const_iterator end)
+{
+    //Server ignored Range and sent the whole file, so cut the ranges out here instead.
+    if(httpCode == 200)
+    {
+        for(auto itr = begin; itr != end; itr++)
+        {
+            auto rangeEnd = itr->end == -1 ? static_cast<int64_t>(body.size()) - 1 : itr->end;
+            if(rangeEnd >= static_cast<int64_t>(body.size()) || itr->start > rangeEnd)
+                ERR_OUT(url << " is shorter than its inventory.");
+
+            grib.append(body.data() + itr->start, rangeEnd - itr->start + 1);
+        }
+        return;
+    }
+
+    auto boundaryAt = contentType.find("boundary=");
+    if(strncasecmp(contentType.c_str(), "multipart/byteranges", 20) || boundaryAt == string::npos)
+    {
+        grib.append(body);
+        return;
+    }
+
+    auto boundary = contentType.substr(boundaryAt + 9);
+    if(!boundary.empty() && boundary.front() == '"')
+        boundary = boundary.substr(1, boundary.find('"', 1) - 1);
+
+    boundary = "--" + boundary;
+
+    //Parts are supposed to come back in the order they were asked for, but that's only a should, so sort them by where they start.
+    vector<pair<int64_t, string_view>> parts;
+    string_view remaining(body);
+    while(true)
+    {
+        auto boundaryStart = remaining.find(boundary);
+        if(boundaryStart == string_view::npos)
+            ERR_OUT(url << ": multipart response ended without a closing boundary.");
+
+        remaining.remove_prefix(boundaryStart + boundary.size());
+        if(remaining.starts_with("--"))
+            break;
+
+        auto headersEnd = remaining.find("\r\n\r\n");
+        if(headersEnd == string_view::npos)
+            ERR_OUT(url << ": multipart response part has no body.");
+
+        int64_t partStart = -1, partEnd = -1;
+        auto headers = remaining.substr(0, headersEnd);
+        while(!headers.empty())
+        {
+            auto lineEnd = headers.find("\r\n");
+            auto header = headers.substr(0, lineEnd);
+            headers.remove_prefix(lineEnd == string_view::npos ? headers.size() : lineEnd + 2);
+
+            if(header.size() > 14 && !strncasecmp(header.data(), "Content-Range:", 14))
+                sscanf(string(header.substr(14)).c_str(), " bytes %" SCNd64 "-%" SCNd64, &partStart, &partEnd);
+        }
+
+        remaining.remove_prefix(headersEnd + 4);
+        if(partStart < 0 || partEnd < partStart || static_cast<size_t>(partEnd - partStart + 1) > remaining.size())
+            ERR_OUT(url << ": multipart response part has a bad Content-Range.");
+
+        parts.push_back({ partStart, remaining.substr(0, partEnd - partStart + 1) });
+        remaining.remove_prefix(partEnd - partStart + 1);
+    }
+
+    sort(parts.begin(), parts.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+    for(auto& part : parts)
+        grib.append(part.second);
+}
+
+size_t DownloadWantedMessages(const string& url, WeatherModel weatherModel, string& grib, int32_t& totalMessages, int32_t& wantedMessages, 
+    size_t& rangeCount, ptrdiff_t maxRangesPerRequest)
+{
+    string inventory;
+    HttpClient::Get((url + ".idx").c_str(), inventory);
+    auto ranges = GetByteRangesFromInventory(inventory, weatherModel, totalMessages, wantedMessages);
+    if(ranges.empty())
+        ERR_OUT(url << ".idx has none of the messages needed.");
+
+    rangeCount = ranges.size();
+    size_t bytesDownloaded = 0;
+    for(auto rangeItr = ranges.cbegin(); rangeItr != ranges.cend();)
+    {
+        //Keeps the Range header to a sane length. NOMADS doesn't seem to mind a few dozen.
+        auto rangeEnd = rangeItr + min(maxRangesPerRequest, ranges.cend() - rangeItr);
+        auto rangeHeader = ToRangeHeader(rangeItr, rangeEnd);
+        string body, contentType;
+
+        auto httpCode = HttpClient::Get(url.c_str(), body, rangeHeader.c_str(), &contentType);
+        AppendByteRangeResponse(grib, url, httpCode, contentType, body, rangeItr, rangeEnd);
+
+        bytesDownloaded += body.size();
+        rangeItr = rangeEnd;
+    }
+
+    return bytesDownloaded;
+}
\ No newline at end of file
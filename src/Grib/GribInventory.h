@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Grib.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//Inclusive, with an end of -1 running to the end of the file, the same as an HTTP Range.
+struct GribByteRange {
+    int64_t start, end;
+};
+
+//Reads a NOAA .idx inventory ("n:offset:d=YYYYMMDDHH:VAR:level:forecast:") and returns the byte ranges of only the messages GribReader
+//has a use for, with neighbours merged into one range.
+std::vector<GribByteRange> GetByteRangesFromInventory(const std::string& inventory, WeatherModel weatherModel, int32_t& totalMessages, int32_t& wantedMessages);
+
+//"0-99,200-" for curl's CURLOPT_RANGE.
+std::string ToRangeHeader(std::vector<GribByteRange>::const_iterator begin, std::vector<GribByteRange>::const_iterator end);
+
+//Appends the parts of a ranged response to grib in file order, so what comes out is a normal GRIB file of just the wanted messages.
+//Handles a multipart/byteranges 206, a single range 206, and a 200 from a server that ignored the ranges.
+void AppendByteRangeResponse(std::string& grib, const std::string& url, long httpCode, const std::string& contentType, const std::string& body,
+    std::vector<GribByteRange>::const_iterator begin, std::vector<GribByteRange>::const_iterator end);
+
+//Gets url's .idx, then only the wanted messages out of url, maxRangesPerRequest ranges at a time, appended to grib.
+//Returns how many bytes came over the wire for the GRIB itself.
+size_t DownloadWantedMessages(const std::string& url, WeatherModel weatherModel, std::string& grib, int32_t& totalMessages, int32_t& wantedMessages, 
+    size_t& rangeCount, ptrdiff_t maxRangesPerRequest = 32);
\ No newline at end of file
@@ -3,22 +3,40 @@
 #include "Characters.h"
 #include "DateTime.h"
 #include "Data/StringCache.h"
+#include "EnsembleReduction.h"
 #include "Error.h"
 #include "GribData.h"
 #include "GribReader.h"
+#include "GribUnpacker.h"
+#include "GridDefinition.h"
+#include "GridGeometryCache.h"
+#include "MappedGribFile.h"
+#include "ModelBlend.h"
 #include "NumberFormat.h"
+#include "Regrid.h"
+#include "TemporalDerivations.h"
 
+#include <algorithm>
+#include <cstring>
 #include <eccodes.h>
 #include <filesystem>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <omp.h>
-#include <stack>
+#include <set>
 
 using namespace std;
 using namespace chrono;
 namespace fs = std::filesystem;
 
 const Wx emptyWx = {PrecipitationType::NoPrecipitation};
+const int32_t subHourlyStepMinutes = 15;
+
+//Each decode thread keeps one values buffer around for every message it unpacks, instead of allocating per message.
+thread_local vector<double> valuesBuffer;
+thread_local vector<double> validationBuffer;
 
 struct LocalForecastPayload {
     const Vector2d bounds[4];
@@ -42,6 +60,15 @@ inline int32_t GetInt(codes_handle* h, const char* property)
 
 #define GetInt(property, result) result = GetInt(h, property)
 
+//md5 of the grid definition section, so anything that changes the grid (including the NOMADS subregion) changes the hash.
+inline string GetGridHash(codes_handle* h)
+{
+    char buffer[64] = {0};
+    size_t length = 64;
+    CODES_CHECK(codes_get_string(h, "md5GridSection", buffer, &length), "Unable to get md5GridSection");
+    return buffer;
+}
+
 inline double LocalForecast(const Vector2d& v, const LocalForecastPayload& payload)
 {
     double resultWeights[4] = {0};
@@ -69,42 +96,216 @@ inline double LocalForecast(const Vector2d& v, const LocalForecastPayload& paylo
 #define ShortNameIs(value) !strcmp(fieldData.shortName, value)
 #define TypeOfLevelIs(value) !strcmp(fieldData.typeOfLevel, value)
 #define LevelIs(value) !strcmp(fieldData.level, value)
+//Fields with no message in the hour are left at zero.
 #define FOR_FORECASTS_IN_RANGE(i) for(auto i = skipToGribNumber; i <= maxGribIndex; i++)
 
+//Everything here comes out of the section headers, so a message that isn't one of the GribFields never gets its values unpacked.
+//Each model gets its own, so none of the per message checks need to ask which model they're looking at.
+template <WeatherModel wxModel>
+GribField ClassifyMessage(const FieldData& fieldData);
+
+template <>
+GribField ClassifyMessage<WeatherModel::HRRR>(const FieldData& fieldData)
+{
+    if(ShortNameIs("crain"))
+        return GribField::CategoricalRainField;
+    else if(ShortNameIs("cfrzr"))
+        return GribField::CategoricalFreezingRainField;
+    else if(ShortNameIs("csnow"))
+        return GribField::CategoricalSnowField;
+    else if(ShortNameIs("prate"))
+        return GribField::PrecipitationRateField;
+    else if(ShortNameIs("tp"))
+        return fieldData.stepRange[0] == '0' && fieldData.stepRange[1] == '-' ? GribField::TotalPrecipitationField : GribField::NewPrecipitationField;
+    else if(ShortNameIs("sde"))
+        return GribField::SnowDepthField;
+    else if(ShortNameIs("asnow") || fieldData.parameterNumber == 29)
+        return GribField::TotalSnowField;
+    else if(ShortNameIs("2d"))
+        return GribField::DewpointField;
+    else if(ShortNameIs("2t"))
+        return GribField::TemperatureField;
+    else if(ShortNameIs("tcc") && TypeOfLevelIs("atmosphere"))
+        return GribField::TotalCloudCoverField;
+    else if(ShortNameIs("vis"))
+        return GribField::VisibilityField;
+    else if(ShortNameIs("10si"))
+        return GribField::WindSpeedField;
+    else if(ShortNameIs("gust"))
+        return GribField::GustField;
+    else if(ShortNameIs("10u"))
+        return GribField::WindUField;
+    else if(ShortNameIs("10v"))
+        return GribField::WindVField;
+    else if(ShortNameIs("mslma"))
+        return GribField::PressureField;
+    else if(ShortNameIs("ltng"))
+        return GribField::LightningField;
+
+    return GribField::UnusedGribField;
+}
+
+template <>
+GribField ClassifyMessage<WeatherModel::GFS>(const FieldData& fieldData)
+{
+    if(ShortNameIs("crain"))
+        return GribField::CategoricalRainField;
+    else if(ShortNameIs("cfrzr"))
+        return GribField::CategoricalFreezingRainField;
+    else if(ShortNameIs("csnow"))
+        return GribField::CategoricalSnowField;
+    else if(ShortNameIs("prate"))
+        return GribField::PrecipitationRateField;
+    else if(ShortNameIs("tp"))
+        return fieldData.stepRange[0] == '0' && fieldData.stepRange[1] == '-' ? GribField::TotalPrecipitationField : GribField::NewPrecipitationField;
+    else if(ShortNameIs("sde"))
+        return GribField::SnowDepthField;
+    else if(ShortNameIs("asnow"))
+        return GribField::TotalSnowField;
+    else if(ShortNameIs("2d"))
+        return GribField::DewpointField;
+    else if(ShortNameIs("t"))
+        return GribField::TemperatureField;
+    else if(ShortNameIs("tcc") && TypeOfLevelIs("atmosphere"))
+        return GribField::TotalCloudCoverField;
+    else if(ShortNameIs("vis") && TypeOfLevelIs("surface"))
+        return GribField::VisibilityField;
+    else if(ShortNameIs("gust"))
+        return GribField::GustField;
+    else if(ShortNameIs("10u"))
+        return GribField::WindUField;
+    else if(ShortNameIs("10v"))
+        return GribField::WindVField;
+    else if(ShortNameIs("mslet"))
+        return GribField::PressureField;
+    else if(ShortNameIs("ltng"))
+        return GribField::LightningField;
+
+    return GribField::UnusedGribField;
+}
+
+//pgrb2a, the half degree GEFS files, have no dewpoint, visibility, gust or lightning, so those stay empty.
+template <>
+GribField ClassifyMessage<WeatherModel::GEFS>(const FieldData& fieldData)
+{
+    if(ShortNameIs("crain"))
+        return GribField::CategoricalRainField;
+    else if(ShortNameIs("cfrzr"))
+        return GribField::CategoricalFreezingRainField;
+    else if(ShortNameIs("csnow"))
+        return GribField::CategoricalSnowField;
+    else if(ShortNameIs("prate"))
+        return GribField::PrecipitationRateField;
+    else if(ShortNameIs("tp"))
+        return GribField::PrecipitationBucketField;
+    else if(ShortNameIs("sde"))
+        return GribField::SnowDepthField;
+    else if(ShortNameIs("2t"))
+        return GribField::TemperatureField;
+    else if(ShortNameIs("tcc") && TypeOfLevelIs("atmosphere"))
+        return GribField::TotalCloudCoverField;
+    else if(ShortNameIs("10u"))
+        return GribField::WindUField;
+    else if(ShortNameIs("10v"))
+        return GribField::WindVField;
+    else if(ShortNameIs("prmsl"))
+        return GribField::PressureField;
+
+    return GribField::UnusedGribField;
+}
+
+template <double (*convert)(double)>
+inline void ConvertColumn(vector<double>& column)
+{
+    auto data = column.data();
+    #pragma omp simd
+    for(size_t i = 0; i < column.size(); i++)
+        data[i] = convert(data[i]);
+}
+
+//Converts a whole column out of GRIB units at once, right after the message is decoded.
+inline void ConvertColumnForField(GribField field, vector<double>& column)
+{
+    switch(field)
+    {
+        case GribField::PrecipitationRateField:
+            return ConvertColumn<ToInPerHour>(column);
+        case GribField::TotalPrecipitationField:
+        case GribField::NewPrecipitationField:
+        case GribField::PrecipitationBucketField:
+            return ConvertColumn<ToInchesFromKgPerSquareMeter>(column);
+        case GribField::SnowDepthField:
+        case GribField::TotalSnowField:
+            return ConvertColumn<ToInchesFromMeters>(column);
+        case GribField::DewpointField:
+        case GribField::TemperatureField:
+            return ConvertColumn<ToFarenheight>(column);
+        case GribField::VisibilityField:
+            return ConvertColumn<ToMiles>(column);
+        case GribField::WindSpeedField:
+        case GribField::GustField:
+            return ConvertColumn<ToMPH>(column);
+        case GribField::PressureField:
+            return ConvertColumn<ToInHg>(column);
+        default:
+            return;
+    }
+}
+
+inline PrecipitationType PrecipitationTypeForField(GribField field)
+{
+    switch(field)
+    {
+        case GribField::CategoricalRainField:
+            return PrecipitationType::Rain;
+        case GribField::CategoricalFreezingRainField:
+            return PrecipitationType::FreezingRain;
+        case GribField::CategoricalSnowField:
+            return PrecipitationType::Snow;
+        default:
+            return PrecipitationType::NoPrecipitation;
+    }
+}
+
+template <WeatherModel wxModel>
 class GribReader : public IGribReader
 {
 private:
     uint16_t skipToGribNumber, maxGribIndex, totalDays;
+    GribReadModes readModes;
     int32_t forecastTimeIndex = 0;
     string gribPathTemplate;
     system_clock::time_point forecastStartTime;
     vector<tuple<string, Location>> locations;
     GeographicCalcs geoCalcs;
 
-    WeatherModel wxModel;
+    string gridHash;
+    int32_t numberOfGridPoints = 0;
+    GridDefinition grid;
     vector<int32_t> validIndexes;
     
     unordered_map<int32_t, GeoCoord> geoCoords;
+    //Only filled in for grids GridDefinition doesn't know, which are the only ones FindCachedIndex needs it for.
     unordered_map<GeoCoord, int32_t> geoCoordLookup;
     vector<system_clock::time_point> localForecastTimes;
     vector<QuadIndexes> quads;
-    vector<unordered_map<int32_t, vector<FieldData>>> rawFieldData;
+    vector<RawForecastHour> rawFieldData;
+    //Lines up with rawFieldData. True for the hours that weren't downloaded and were filled in from the ones around them.
+    vector<uint8_t> interpolatedHours;
+    //Lines up with rawFieldData when reading an ensemble, one per point.
+    vector<vector<EnsembleStats>> ensembleHourStats;
 
     GeoBounds geoBounds;
 
+    //Set while running tile by tile. The geometry is cut down to haloCells, but only quads with their top left in tileCells are kept,
+    //so each quad belongs to exactly one tile and the ones along a tile's edge still have all four corners.
+    bool tiled = false;
+    GridCellRange tileCells = {}, haloCells = {};
+
     inline bool IsInArea(const GeoBounds& geoBounds, const GeoCoord& coord) { return IsBetween(geoBounds.bottomLat, coord.lat, geoBounds.topLat) && IsBetween(geoBounds.leftLon, coord.lon, geoBounds.rightLon); }
 
     inline bool CheckGeoCoordsIndex(int32_t index) { return geoCoords.find(index) != geoCoords.end();}
 
-    inline void PopPointsFromStackToVector(vector<int32_t>& validIndexes, stack<int32_t>& forNorthToSouth)
-    {
-        while(!forNorthToSouth.empty())
-        {
-            validIndexes.insert(validIndexes.begin(), forNorthToSouth.top());
-            forNorthToSouth.pop();
-        }
-    }
-
     FILE* OpenFile(const string& fileName)
     {
         auto file = fopen(fileName.c_str(), "rb");
@@ -115,27 +316,190 @@ private:
         return file;
     }
 
-    bool ReadGribFile(const string& fileName)
-    {    
-        int32_t err = 0;
-        codes_handle* h = nullptr;
+    static string GetGribPath(const string& pathTemplate, uint16_t gribNumber)
+    {
+        char path[FILENAME_MAX] = {0};
+        snprintf(path, FILENAME_MAX, pathTemplate.c_str(), gribNumber);
+        return path;
+    }
+
+    string GetGribPath(uint16_t gribNumber) { return GetGribPath(gribPathTemplate, gribNumber); }
+
+    inline bool HasReadMode(GribReadModes mode) { return (readModes & mode) == mode; }
+
+    inline int32_t StepsPerFile() { return HasReadMode(SubHourlyGribReadMode) ? 60 / subHourlyStepMinutes : 1; }
+
+    //Which of a file's steps a message ending endMinute into the forecast goes to. The first file only has the analysis.
+    inline int32_t StepInFile(int32_t endMinute) { return StepsPerFile() == 1 || endMinute <= 0 ? 0 : ((endMinute - 1) % 60) / subHourlyStepMinutes; }
+
+    inline void RequireOneStepPerFile(const char* reading)
+    {
+        if(HasReadMode(SubHourlyGribReadMode))
+            ERR_OUT(reading << " reads one step per file, so it can't take sub-hourly GRIBs.");
+    }
+
+    vector<uint16_t> GetGribNumbersOnDisk()
+    {
+        vector<uint16_t> gribNumbers;
+        FOR_FORECASTS_IN_RANGE(i)
+        {
+            if(fs::exists(GetGribPath(i)))
+                gribNumbers.push_back(i);
+        }
+
+        if(gribNumbers.empty())
+            ERR_OUT("No grib files to read.");
+
+        return gribNumbers;
+    }
 
-        if(!fs::exists(fileName))
+    //The hours that were read, and with InterpolateMissingHoursGribReadMode, every published hour between the first and last of them that wasn't, flagged in interpolated.
+    vector<uint16_t> WithMissingHours(const vector<uint16_t>& readNumbers, vector<uint8_t>& interpolated)
+    {
+        if(readNumbers.empty() || !HasReadMode(InterpolateMissingHoursGribReadMode))
+        {
+            interpolated.assign(readNumbers.size(), false);
+            return readNumbers;
+        }
+
+        vector<uint16_t> gribNumbers;
+        interpolated.clear();
+        size_t nextRead = 0;
+        for(uint32_t hour = readNumbers.front(); hour <= readNumbers.back(); hour++)
+        {
+            auto wasRead = hour == readNumbers[nextRead];
+            if(wasRead)
+                nextRead++;
+            else if(!IsForecastHourPublished(wxModel, static_cast<uint16_t>(hour)))
+                continue;
+
+            gribNumbers.push_back(static_cast<uint16_t>(hour));
+            interpolated.push_back(!wasRead);
+        }
+
+        return gribNumbers;
+    }
+
+    void InterpolateMissingHours(const vector<uint16_t>& gribNumbers)
+    {
+        auto missing = count(interpolatedHours.begin(), interpolatedHours.end(), true);
+        if(!missing)
+            return;
+
+        cout << "Interpolating " << missing << " hours that weren't downloaded..." << endl;
+        InterpolateHours(rawFieldData, gribNumbers, interpolatedHours, validIndexes.size());
+    }
+
+    //Only fills in valuesBuffer at validIndexes. False when the packing is one GribUnpacker leaves to eccodes.
+    bool UnpackValidValues(codes_handle* h, const string& fileName)
+    {
+        const void* message = nullptr;
+        size_t messageLength = 0;
+        double missingValue = 9999;
+        CODES_CHECK(codes_get_message(h, &message, &messageLength), "Unable to get message");
+        codes_get_double(h, "missingValue", &missingValue);
+
+        if(!UnpackGribValues(static_cast<const uint8_t*>(message), messageLength, validIndexes.data(), validIndexes.size(), missingValue, valuesBuffer.data()))
             return false;
 
-        rawFieldData.resize(rawFieldData.size() + 1);
-        auto& currentFieldData = rawFieldData[rawFieldData.size() - 1];
+        if(!HasReadMode(GribReadModes::ValidateUnpackGribReadMode))
+            return true;
 
-        if(!geoCoords.size())
-            PrepareParallelDataBasedOffOfFile(fileName);
+        //Has to agree with eccodes to the bit, or it's not safe to use.
+        size_t length = numberOfGridPoints;
+        validationBuffer.resize(numberOfGridPoints);
+        CODES_CHECK(codes_get_double_array(h, "values", validationBuffer.data(), &length), "Unable to get values");
+        for(auto& index : validIndexes)
+        {
+            if(memcmp(&valuesBuffer[index], &validationBuffer[index], sizeof(double)))
+            {
+                char shortName[64] = {0};
+                size_t shortNameLength = 64;
+                codes_get_string(h, "shortName", shortName, &shortNameLength);
+                ERR_OUT(fileName << ": native unpack of " << shortName << " differs from eccodes at grid point " << index << ": " 
+                    << setprecision(17) << valuesBuffer[index] << " vs " << validationBuffer[index]);
+            }
+        }
 
-        auto file = OpenFile(fileName);
-        int32_t overallIndex = 0;
-        while ((h = codes_handle_new_from_file(nullptr, file, PRODUCT_GRIB, &err)) != nullptr)
+        return true;
+    }
+
+    const double* ReadValues(codes_handle* h, int32_t numberOfPoints, const string& fileName)
+    {
+        if(valuesBuffer.size() < static_cast<size_t>(max(numberOfPoints, numberOfGridPoints)))
+            valuesBuffer.resize(max(numberOfPoints, numberOfGridPoints));
+
+        //The geometry (and validIndexes) came from the first file, so as long as the grid is the same, only the values need unpacking.
+        if(GetGridHash(h) == gridHash)
         {
-            int32_t numberOfPoints = 0;
+            if(HasReadMode(GribReadModes::NativeUnpackGribReadMode) && UnpackValidValues(h, fileName))
+                return valuesBuffer.data();
+
+            size_t length = numberOfPoints;
+            CODES_CHECK(codes_get_double_array(h, "values", valuesBuffer.data(), &length), "Unable to get values");
+            return valuesBuffer.data();
+        }
+
+        #pragma omp critical
+        cerr << fileName << ": grid does not match the one the geometry was built from, falling back to a full decode." << endl;
+
+        //Indexes mean nothing across grids, so put each decoded point back where the cached geometry has the same coordinate.
+        unique_ptr<double[]> lats(new double[numberOfPoints]);
+        unique_ptr<double[]> lons(new double[numberOfPoints]);
+        unique_ptr<double[]> values(new double[numberOfPoints]);
+        codes_grib_get_data(h, lats.get(), lons.get(), values.get());
+
+        fill(valuesBuffer.begin(), valuesBuffer.end(), 0.0);
+        for(int32_t i = 0; i < numberOfPoints; i++)
+        {
+            auto index = FindCachedIndex({lats[i], lons[i]});
+            if(index != -1)
+                valuesBuffer[index] = values[i];
+        }
+
+        return valuesBuffer.data();
+    }
+
+    //Coordinates worked out from the grid definition won't always match the iterator's to the last bit, so when there is one, land on the nearest cell instead.
+    int32_t FindCachedIndex(const GeoCoord& coord)
+    {
+        if(!grid.IsSupported())
+        {
+            auto itr = geoCoordLookup.find(coord);
+            return itr != geoCoordLookup.end() ? itr->second : -1;
+        }
+
+        double column = 0, row = 0;
+        grid.ToGridPoint(coord, column, row);
+        if(fabs(column - round(column)) > 1e-3 || fabs(row - round(row)) > 1e-3)
+            return -1;
+
+        auto index = grid.ToIndex(static_cast<int32_t>(round(column)), static_cast<int32_t>(round(row)));
+        return CheckGeoCoordsIndex(index) ? index : -1;
+    }
+
+    //stepFor hands back the step a message goes to, by the minute its forecast time ends on, which is only worked out for sub-hourly files.
+    template <typename NextHandle, typename StepFor>
+    void ReadGribMessages(const string& fileName, StepFor stepFor, NextHandle nextHandle)
+    {    
+        int32_t totalMessages = 0, skippedMessages = 0;
+        size_t skippedValueBytes = 0;
+        codes_handle* h = nullptr;
+        auto subHourly = HasReadMode(SubHourlyGribReadMode);
+
+        while ((h = nextHandle()) != nullptr)
+        {
+            int32_t numberOfPoints = 0, endMinute = 0;
             FieldData fieldData = {0};
 
+            totalMessages++;
+            if(subHourly)
+            {
+                size_t unitsLength = 1;
+                CODES_CHECK(codes_set_string(h, "stepUnits", "m", &unitsLength), "Unable to set stepUnits");
+                GetInt("endStep", endMinute);
+            }
+
             GetString(fieldData, name)
             GetString(fieldData, level)
             GetString(fieldData, shortName)
@@ -144,40 +508,151 @@ private:
             GetInt("parameterNumber", fieldData.parameterNumber);
             GetInt("numberOfPoints", numberOfPoints);
 
-            unique_ptr<double[]> lats(new double[numberOfPoints]);
-            unique_ptr<double[]> lons(new double[numberOfPoints]);
-            unique_ptr<double[]> values(new double[numberOfPoints]);
-            codes_grib_get_data(h, lats.get(), lons.get(), values.get());
-            
-            for(auto& index : validIndexes)
+            auto field = ClassifyMessage<wxModel>(fieldData);
+            if(subHourly && (field == GribField::TotalPrecipitationField || field == GribField::NewPrecipitationField))
+                field = GribField::PrecipitationBucketField;
+
+            if(field == GribField::UnusedGribField)
+            {
+                skippedMessages++;
+                skippedValueBytes += numberOfPoints * sizeof(double);
+                codes_handle_delete(h);
+                continue;
+            }
+
+            auto values = ReadValues(h, numberOfPoints, fileName);
+            auto& rawForecastHour = stepFor(endMinute);
+            //The categorical types only ever turn a precipitation type on, so they can't be cleared by a later message.
+            if(IsCategoricalGribField(field))
+            {
+                auto type = PrecipitationTypeForField(field);
+                auto& types = rawForecastHour.precipitationTypes;
+                if(types.empty())
+                    types.resize(validIndexes.size(), PrecipitationType::NoPrecipitation);
+
+                for(size_t i = 0; i < validIndexes.size(); i++)
+                {
+                    if(values[validIndexes[i]])
+                        types[i] |= type;
+                }
+            }
+            else
             {
-                fieldData.value = values[index];
-                currentFieldData[index].push_back(fieldData);
+                auto& column = rawForecastHour.fields[field];
+                column.resize(validIndexes.size());
+                for(size_t i = 0; i < validIndexes.size(); i++)
+                    column[i] = values[validIndexes[i]];
+
+                ConvertColumnForField(field, column);
+                rawForecastHour.stepStarts[field] = atoi(fieldData.stepRange);
             }
 
             codes_handle_delete(h);
         }
 
+        #pragma omp critical
+        cout << fs::path(fileName).filename().string() << ": decoded " << (totalMessages - skippedMessages) << " of " << totalMessages << " messages, skipped " 
+            << skippedMessages << " (" << ToStringWithPrecision(1, skippedValueBytes / (1024.0 * 1024.0)) << " MB of values not unpacked)" << endl;
+    }
+
+    void ReadGribFile(const string& fileName, RawForecastHour& rawForecastHour) { ReadGribFileSteps(fileName, [&](int32_t) -> RawForecastHour& { return rawForecastHour; }); }
+
+    template <typename StepFor>
+    void ReadGribFileSteps(const string& fileName, StepFor stepFor)
+    {
+        if((readModes & GribReadModes::MappedGribReadMode) == GribReadModes::MappedGribReadMode)
+        {
+            //Handles only point into the mapping, so it has to outlive every one of them.
+            MappedGribFile mappedFile(fileName);
+            ReadGribMessages(fileName, stepFor, [&]() -> codes_handle* {
+                const void* message = nullptr;
+                size_t length = 0;
+                if(!mappedFile.NextMessage(message, length))
+                    return nullptr;
+
+                auto h = codes_handle_new_from_message(nullptr, message, length);
+                if(!h)
+                    ERR_OUT(fileName << ": unable to read GRIB message.");
+
+                return h;
+            });
+            return;
+        }
+
+        int32_t err = 0;
+        auto file = OpenFile(fileName);
+        ReadGribMessages(fileName, stepFor, [&]() { return codes_handle_new_from_file(nullptr, file, PRODUCT_GRIB, &err); });
         fclose(file);
-        return true;
     }
 
-    void CollectGeoCoordsInBounds(FILE* file, int32_t& columns, vector<int32_t>& validIndexes)
+    //Handles point straight into the buffer, same as with a mapped file.
+    codes_handle* NextHandleFromBuffer(const GribBuffer& buffer, size_t& offset, const string& name)
+    {
+        const void* message = nullptr;
+        size_t length = 0;
+        if(!NextGribMessage(reinterpret_cast<const uint8_t*>(buffer.bytes.data()), buffer.bytes.size(), offset, message, length, name))
+            return nullptr;
+
+        auto h = codes_handle_new_from_message(nullptr, message, length);
+        if(!h)
+            ERR_OUT(name << ": unable to read GRIB message.");
+
+        return h;
+    }
+
+    template <typename StepFor>
+    void ReadGribBufferSteps(const GribBuffer& buffer, const string& name, StepFor stepFor)
+    {
+        size_t offset = 0;
+        ReadGribMessages(name, stepFor, [&]() { return NextHandleFromBuffer(buffer, offset, name); });
+    }
+
+    //Only visits the block of cells that can overlap geoBounds, instead of every point in the grid, and walks it north to south, west to east,
+    //so validIndexes comes out in order without any reshuffling.
+    void CollectGeoCoordsFromGrid(vector<int32_t>& validIndexes)
+    {
+        int32_t firstColumn = 0, lastColumn = 0, firstRow = 0, lastRow = 0;
+        if(!grid.GetCellRangeForBounds(geoBounds, firstColumn, lastColumn, firstRow, lastRow))
+            ERR_OUT("Selected region is outside of the grid.");
+
+        if(tiled)
+        {
+            firstColumn = max(firstColumn, haloCells.firstColumn);
+            lastColumn = min(lastColumn, haloCells.lastColumn);
+            firstRow = max(firstRow, haloCells.firstRow);
+            lastRow = min(lastRow, haloCells.lastRow);
+            if(firstColumn > lastColumn || firstRow > lastRow)
+                return;
+        }
+
+        auto northernRow = grid.RowsScanNorthward() ? lastRow : firstRow;
+        auto southernRow = grid.RowsScanNorthward() ? firstRow : lastRow;
+        for(auto row = northernRow; ; row = grid.RowToTheSouth(row))
+        {
+            for(auto column = firstColumn; column <= lastColumn; column++)
+            {
+                auto coord = grid.ToGeoCoord(column, row);
+                if(!IsInArea(geoBounds, coord))
+                    continue;
+
+                auto index = grid.ToIndex(column, row);
+                geoCoords[index] = coord;
+                validIndexes.push_back(index);
+            }
+
+            if(row == southernRow)
+                break;
+        }
+    }
+
+    //For grids GridDefinition doesn't know. Still has to look at every point, but only once.
+    void CollectGeoCoordsFromIterator(codes_handle* h, vector<int32_t>& validIndexes)
     {
         int32_t err = 0, overallIndex = 0;
-        stack<int32_t> forNorthToSouth;
-        codes_handle* h = codes_handle_new_from_file(nullptr, file, PRODUCT_GRIB, &err);
-        if (err != CODES_SUCCESS) 
-            CODES_CHECK(err, 0);
-            
+        vector<vector<int32_t>> rows;
         codes_iterator* iter = codes_grib_iterator_new(h, 0, &err);
         if (err != CODES_SUCCESS) 
             CODES_CHECK(err, 0);
-        
-        if(wxModel == WeatherModel::HRRR)
-            GetInt("Nx", columns);
-        else
-            GetInt("Ni", columns);
 
         double value = 0;
         GeoCoord coord = {0}, lastCoord = { 361.0, 361.0 };
@@ -188,33 +663,55 @@ private:
                 continue;
 
             //Assuming default of WE:SN coming out of the GRIB, but doing a thing to work with the data as WE:NS
-            if(coord.lon < lastCoord.lon) 
-                PopPointsFromStackToVector(validIndexes, forNorthToSouth);
+            if(rows.empty() || coord.lon < lastCoord.lon) 
+                rows.emplace_back();
 
             geoCoords[currentOverallIndex] = coord;
-            forNorthToSouth.emplace(currentOverallIndex);
+            rows.back().push_back(currentOverallIndex);
             lastCoord = coord;
         }
 
-        PopPointsFromStackToVector(validIndexes, forNorthToSouth);
+        for(auto row = rows.rbegin(); row != rows.rend(); row++)
+            validIndexes.insert(validIndexes.end(), row->begin(), row->end());
 
         codes_grib_iterator_delete(iter);
-        codes_handle_delete(h);
-        h = nullptr;
+    }
+
+    //Returns how far apart in index a point and the one south of it are.
+    int32_t CollectGeoCoordsInBounds(codes_handle* h, vector<int32_t>& validIndexes)
+    {
+        int32_t columns = 0;
+        if(grid.IsSupported())
+        {
+            CollectGeoCoordsFromGrid(validIndexes);
+            return grid.ToIndex(0, grid.RowToTheSouth(0));
+        }
+
+        if constexpr(wxModel == WeatherModel::HRRR)
+            GetInt("Nx", columns);
+        else
+            GetInt("Ni", columns);
+
+        CollectGeoCoordsFromIterator(h, validIndexes);
+        return -columns;
     }    
 
-    void BuildQuads(int32_t columns, vector<int32_t>& validIndexes)
+    void BuildQuads(int32_t southOffset, vector<int32_t>& validIndexes)
     {
         for(auto& validIndex : validIndexes)
         {
             QuadIndexes quad = {
                 .topLeft = validIndex,
                 .topRight = validIndex + 1,
-                .bottomLeft = validIndex - columns,
-                .bottomRight = validIndex - columns + 1 
+                .bottomLeft = validIndex + southOffset,
+                .bottomRight = validIndex + southOffset + 1 
             };
 
-            geoCoordLookup[geoCoords[validIndex]] = validIndex;
+            if(!grid.IsSupported())
+                geoCoordLookup[geoCoords[validIndex]] = validIndex;
+
+            if(tiled && !tileCells.Contains(validIndex % grid.GetColumns(), validIndex / grid.GetColumns()))
+                continue;
 
             if(CheckGeoCoordsIndex(quad.topLeft) && CheckGeoCoordsIndex(quad.topRight) && CheckGeoCoordsIndex(quad.bottomLeft) && CheckGeoCoordsIndex(quad.bottomRight))
             {
@@ -225,30 +722,248 @@ private:
         }
     }
 
-    void PrepareParallelDataBasedOffOfFile(const string& fileName)
+    bool LoadCachedGeometry(const fs::path& cachePath)
+    {
+        auto mapped = unique_ptr<MappedGridGeometry>(MappedGridGeometry::Open(cachePath, gridHash, geoBounds));
+        if(!mapped)
+            return false;
+
+        auto numberOfPoints = mapped->GetNumberOfPoints();
+        auto cachedIndexes = mapped->GetValidIndexes();
+        auto cachedCoords = mapped->GetGeoCoords();
+
+        validIndexes.assign(cachedIndexes, cachedIndexes + numberOfPoints);
+        quads.assign(mapped->GetQuads(), mapped->GetQuads() + mapped->GetNumberOfQuads());
+
+        geoCoords.reserve(numberOfPoints);
+        for(size_t i = 0; i < numberOfPoints; i++)
+            geoCoords[cachedIndexes[i]] = cachedCoords[i];
+
+        if(!grid.IsSupported())
+        {
+            geoCoordLookup.reserve(numberOfPoints);
+            for(size_t i = 0; i < numberOfPoints; i++)
+                geoCoordLookup[cachedCoords[i]] = cachedIndexes[i];
+        }
+
+        cout << "Loaded grid geometry from " << cachePath << endl;
+        return true;
+    }
+
+    void ReadGridDefinition(codes_handle* h)
+    {
+        gridHash = GetGridHash(h);
+        GetInt("numberOfPoints", numberOfGridPoints);
+        grid = GridDefinition(h);
+    }
+
+    void BuildGeometry(codes_handle* h)
+    {
+        auto southOffset = CollectGeoCoordsInBounds(h, validIndexes);
+
+        if(!grid.IsSupported())
+            geoCoordLookup.reserve(validIndexes.size());
+
+        BuildQuads(southOffset, validIndexes);
+    }
+
+    //h is the first message of whichever hour is read first.
+    void PrepareParallelData(codes_handle* h)
     {
-        int32_t columns = 0;    
+        //Only the grid definition section is needed to know whether the cached geometry still applies.
+        ReadGridDefinition(h);
+
+        //A tile's cells are walked straight off the grid definition, which is cheap enough not to leave a cache file per tile.
+        if(tiled)
+        {
+            BuildGeometry(h);
+            return;
+        }
+
+        auto cacheDirectory = fs::path(gribPathTemplate).parent_path();
+        auto cachePath = GetGridGeometryCachePath(cacheDirectory, gridHash, geoBounds);
+        if(!LoadCachedGeometry(cachePath))
+        {
+            BuildGeometry(h);
+
+            RemoveStaleGridGeometry(cacheDirectory, gridHash);
+            SaveGridGeometry(cachePath, gridHash, geoBounds, validIndexes, geoCoords, quads);
+        }
+    }
+
+    template <typename Prepare>
+    void PrepareFromFirstMessageOfFile(const string& fileName, Prepare prepare)
+    {
+        int32_t err = 0;
         auto file = OpenFile(fileName);
-        CollectGeoCoordsInBounds(file, columns, validIndexes);
+        codes_handle* h = codes_handle_new_from_file(nullptr, file, PRODUCT_GRIB, &err);
+        if (err != CODES_SUCCESS) 
+            CODES_CHECK(err, 0);
+
+        prepare(h);
+        codes_handle_delete(h);
         fclose(file);
+    }
 
-        BuildQuads(columns, validIndexes);
+    void PrepareParallelDataBasedOffOfFile(const string& fileName)
+    {
+        PrepareFromFirstMessageOfFile(fileName, [&](codes_handle* h) { PrepareParallelData(h); });
     }
 
-    void Initalize(unique_ptr<IForecastRepo>& forecastRepo)
+    void PrepareParallelDataBasedOffOfBuffer(const GribBuffer& buffer, const string& name)
     {
-        int32_t lastDay = INT32_MAX;
-        cout << "Reading in grib files..." << endl;
-        //Read in files one at a time because that's the way it has to be due to eccodes.
+        size_t offset = 0;
+        auto h = NextHandleFromBuffer(buffer, offset, name);
+        if(!h)
+            ERR_OUT(name << " has no GRIB messages.");
+
+        PrepareParallelData(h);
+        codes_handle_delete(h);
+    }
+
+    void Initalize(unique_ptr<IForecastRepo>& forecastRepo, BoundedQueue<LandedGrib>& gribsToRead, uint16_t decodeThreads)
+    {
+        once_flag geometryPrepared;
+
+        //Each forecast hour is its own file, so each thread gets its own FILE* and codes_handles, and writes only to its own slots, one per step in the file.
+        //Slots are sized up front so nothing grows while the threads are running, and stay in forecast order no matter what order the files show up in.
+        auto stepsPerFile = StepsPerFile();
+        vector<RawForecastHour> rawForecastHours((maxGribIndex - skipToGribNumber + 1) * stepsPerFile);
+        vector<uint8_t> wasRead(rawForecastHours.size(), false);
+        vector<int32_t> stepMinutes(rawForecastHours.size(), 0);
+
+        if(!decodeThreads)
+            decodeThreads = omp_get_max_threads();
+
+        cout << "Reading in grib files across " << decodeThreads << " threads..." << endl;
+        #pragma omp parallel num_threads(decodeThreads)
+        {
+            LandedGrib landed;
+            while(gribsToRead.Pop(landed))
+            {
+                auto path = GetGribPath(landed.gribNumber);
+                auto firstStep = (landed.gribNumber - skipToGribNumber) * stepsPerFile;
+                auto stepFor = [&](int32_t endMinute) -> RawForecastHour& {
+                    auto step = firstStep + StepInFile(endMinute);
+                    wasRead[step] = true;
+                    stepMinutes[step] = endMinute;
+                    return rawForecastHours[step];
+                };
+
+                //Every hour shares the same grid, so whichever file is read first builds the geometry while the rest wait on it.
+                if(landed.buffer)
+                {
+                    auto name = path + " (in memory)";
+                    call_once(geometryPrepared, [&]() { PrepareParallelDataBasedOffOfBuffer(*landed.buffer, name); });
+                    ReadGribBufferSteps(*landed.buffer, name, stepFor);
+                    landed.buffer->Release();
+                }
+                else
+                {
+                    call_once(geometryPrepared, [&]() { PrepareParallelDataBasedOffOfFile(path); });
+                    ReadGribFileSteps(path, stepFor);
+                }
+
+                if(stepsPerFile == 1)
+                    wasRead[firstStep] = true;
+            }
+        }
+
+        //Sub-hourly steps are all downloaded, so there's nothing to fill in, and each one's time comes off its messages.
+        if(stepsPerFile > 1)
+        {
+            vector<int32_t> readMinutes;
+            for(size_t step = 0; step < rawForecastHours.size(); step++)
+            {
+                if(!wasRead[step])
+                    continue;
+
+                readMinutes.push_back(stepMinutes[step]);
+                rawFieldData.push_back(std::move(rawForecastHours[step]));
+            }
+
+            interpolatedHours.assign(rawFieldData.size(), false);
+            if(localForecastTimes.empty())
+                AddForecastStartTimes(forecastRepo, readMinutes);
+
+            return;
+        }
+
+        vector<uint16_t> readNumbers;
         FOR_FORECASTS_IN_RANGE(i)
         {
-            string path(gribPathTemplate.length() + 2, '\0');
-            snprintf((char*)path.c_str(), gribPathTemplate.length() + 2, gribPathTemplate.c_str(), i);
-            
-            if(!ReadGribFile(path))
-                continue;
+            if(wasRead[i - skipToGribNumber])
+                readNumbers.push_back(i);
+        }
+
+        auto gribNumbers = WithMissingHours(readNumbers, interpolatedHours);
+        for(auto& gribNumber : gribNumbers)
+            rawFieldData.push_back(std::move(rawForecastHours[gribNumber - skipToGribNumber]));
+
+        InterpolateMissingHours(gribNumbers);
 
-            auto forecastAtPoint = forecastStartTime + hours(i);
+        //Tiles after the first read the same hours over again, which the forecast repo already has.
+        if(localForecastTimes.empty())
+            AddForecastStartTimes(forecastRepo, gribNumbers);
+    }
+
+    //Every hour on disk into rawFieldData, filled in and derived, without anything going to the forecast repo.
+    vector<uint16_t> ReadDerivedHoursOnDisk()
+    {
+        RequireOneStepPerFile("Blending");
+        auto gribNumbers = WithMissingHours(GetGribNumbersOnDisk(), interpolatedHours);
+        PrepareParallelDataBasedOffOfFile(GetGribPath(gribNumbers.front()));
+
+        rawFieldData.resize(gribNumbers.size());
+        #pragma omp parallel for
+        for(size_t i = 0; i < gribNumbers.size(); i++)
+        {
+            if(!interpolatedHours[i])
+                ReadGribFile(GetGribPath(gribNumbers[i]), rawFieldData[i]);
+        }
+
+        InterpolateMissingHours(gribNumbers);
+        DeriveTemporalFields(wxModel, rawFieldData, validIndexes.size());
+        return gribNumbers;
+    }
+
+    //The file for an hour that was already compiled only has what was read, so everything the derivations had added up to by then
+    //is put back from existing's last hour, for them to carry on from.
+    void CarryOnFrom(GribData& existing, RawForecastHour& carried)
+    {
+        if(existing.GetNumberOfPoints() != validIndexes.size())
+            ERR_OUT("The region's points have changed since the forecast being added on to was read.");
+
+        auto lastFile = static_cast<int32_t>(existing.GetNumberOfFiles()) - 1;
+        for(auto& derivation : GetTemporalDerivations(wxModel))
+        {
+            auto& column = carried.fields[derivation.target];
+            column.resize(validIndexes.size());
+
+            #pragma omp parallel for
+            for(size_t point = 0; point < validIndexes.size(); point++)
+                column[point] = existing.GetValue(derivation.target, point, lastFile);
+        }
+    }
+
+    void AddForecastStartTimes(unique_ptr<IForecastRepo>& forecastRepo, const vector<uint16_t>& gribNumbers)
+    {
+        vector<int32_t> stepMinutes;
+        for(auto& gribNumber : gribNumbers)
+            stepMinutes.push_back(gribNumber * 60);
+
+        AddForecastStartTimes(forecastRepo, stepMinutes);
+    }
+
+    //By minutes into the forecast, so steps can be any length.
+    void AddForecastStartTimes(unique_ptr<IForecastRepo>& forecastRepo, const vector<int32_t>& stepMinutes)
+    {
+        int32_t lastDay = INT32_MAX;
+
+        //The forecast repo expects its start times in order, so those are added back on this thread once everything is read.
+        for(auto& stepMinute : stepMinutes)
+        {
+            auto forecastAtPoint = forecastStartTime + minutes(stepMinute);
             localForecastTimes.push_back(forecastAtPoint);
 
             forecastRepo->AddForecastStartTime(forecastAtPoint);
@@ -267,132 +982,161 @@ private:
 
     GribData* GetCompiledGribData()
     {
-        vector<unordered_map<int32_t, WxAtGeoCoord>> wxResults;
-        wxResults.resize(rawFieldData.size());
+        cout << "Deriving accumulations..." << endl;
+        DeriveTemporalFields(wxModel, rawFieldData, validIndexes.size(), HasReadMode(SubHourlyGribReadMode));
 
-        cout << "Collecting data..." << endl;        
-        #pragma omp parallel for
-        for(auto itr = rawFieldData.begin(); itr != rawFieldData.end(); itr++)
-        {            
-            auto i = itr - rawFieldData.begin();
-            auto& wxResult = wxResults[i];
-            const auto& fieldDatums = *itr;
-            for(const auto& kvp : fieldDatums)
-            {
-                Wx wx = {};
-                for (const auto &fieldData : kvp.second)
-                {                    
-                    if(ShortNameIs("crain") && fieldData.value)
-                        wx.type |= PrecipitationType::Rain;
-                    else if(ShortNameIs("cfrzr") && fieldData.value)
-                        wx.type |= PrecipitationType::FreezingRain;
-                    else if(ShortNameIs("csnow") && fieldData.value)
-                        wx.type |= PrecipitationType::Snow;
-                    else if(ShortNameIs("prate"))
-                        wx.precipitationRate = ToInPerHour(fieldData.value);
-                    else if(ShortNameIs("tp"))
-                    {
-                        if(fieldData.stepRange[0] == '0' && fieldData.stepRange[1] == '-')
-                            wx.totalPrecipitation = ToInchesFromKgPerSquareMeter(fieldData.value);
-                        else
-                            wx.newPrecipitation = ToInchesFromKgPerSquareMeter(fieldData.value);
-                    }
-                    else if(ShortNameIs("sde"))
-                        wx.snowDepth = ToInchesFromMeters(fieldData.value);
-                    else if(ShortNameIs("asnow") || (wxModel == WeatherModel::HRRR && fieldData.parameterNumber == 29))
-                        wx.totalSnow = ToInchesFromMeters(fieldData.value);
-                    else if(ShortNameIs("2d"))
-                        wx.dewpoint = ToFarenheight(fieldData.value);
-                    else if(wxModel == WeatherModel::HRRR && ShortNameIs("2t"))
-                        wx.temperature = ToFarenheight(fieldData.value);
-                    else if(wxModel == WeatherModel::GFS && ShortNameIs("t"))
-                        wx.temperature = ToFarenheight(fieldData.value);
-                    else if(ShortNameIs("tcc") && TypeOfLevelIs("atmosphere"))
-                        wx.totalCloudCover = fieldData.value;
-                    else if(ShortNameIs("vis") && (wxModel == WeatherModel::HRRR || TypeOfLevelIs("surface")))
-                        wx.visibility = ToMiles(fieldData.value);
-                    else if(wxModel == WeatherModel::HRRR && ShortNameIs("10si"))
-                        wx.windSpeed = ToMPH(fieldData.value);
-                    else if(ShortNameIs("gust"))
-                        wx.gust = ToMPH(fieldData.value);
-                    else if(ShortNameIs("10u"))
-                        wx.windU = fieldData.value;
-                    else if(ShortNameIs("10v"))
-                        wx.windV = fieldData.value;
-                    else if(wxModel == WeatherModel::HRRR && ShortNameIs("mslma"))
-                        wx.pressure = ToInHg(fieldData.value);
-                    else if(wxModel == WeatherModel::GFS && ShortNameIs("mslet"))
-                        wx.pressure = ToInHg(fieldData.value);
-                    else if(ShortNameIs("ltng"))
-                        wx.lightning = fieldData.value;
-                }
+        return CompileRawHours(0);
+    }
 
-                wxResult[kvp.first] = {
-                    .coord = geoCoords[kvp.first],
-                    .wx = wx
-                };
+    //Everything in rawFieldData from firstHour on. Hours before it are left alone.
+    GribData* CompileRawHours(size_t firstHour)
+    {
+        auto numberOfPoints = validIndexes.size();
+        auto numberOfFiles = rawFieldData.size() - firstHour;
+
+        //A column goes in if any hour has it, and the hours that don't are left at 0.
+        GribData::WxColumns fields;
+        vector<PrecipitationType> types;
+        for(size_t i = firstHour; i < rawFieldData.size(); i++)
+        {
+            for(auto field : wxFields)
+            {
+                if(fields[field].empty() && !rawFieldData[i].fields[field].empty())
+                    fields[field].resize(numberOfFiles * numberOfPoints);
             }
+
+            if(types.empty() && !rawFieldData[i].precipitationTypes.empty())
+                types.resize(numberOfFiles * numberOfPoints);
         }
 
-        if(wxModel == WeatherModel::GFS)
+        cout << "Collecting data..." << endl;        
+        #pragma omp parallel for
+        for(size_t i = firstHour; i < rawFieldData.size(); i++)
         {
-            for(auto fileItr = wxResults.begin() + 1; fileItr != wxResults.end(); fileItr++)
+            auto fileStart = (i - firstHour) * numberOfPoints;
+            auto& rawForecastHour = rawFieldData[i];
+            if(!rawForecastHour.precipitationTypes.empty())
+                copy(rawForecastHour.precipitationTypes.begin(), rawForecastHour.precipitationTypes.end(), types.begin() + fileStart);
+
+            for(auto field : wxFields)
             {
-                auto& currentMap = *fileItr;
-                auto& previousMap = *(fileItr - 1);
+                auto& rawColumn = rawForecastHour.fields[field];
+                if(rawColumn.empty())
+                    continue;
+
+                auto from = rawColumn.data();
+                auto to = fields[field].data() + fileStart;
+                #pragma omp simd
+                for(size_t point = 0; point < numberOfPoints; point++)
+                    to[point] = static_cast<float>(from[point]);
+            }
 
-                #pragma omp parallel for
-                for(auto& index : validIndexes)
-                {
-                    auto& pWx = currentMap[index].wx;
-                    auto& pPreviousWx = previousMap[index].wx;
+            //Nothing reads the raw columns once the hour is compiled, so give the memory back while the other hours finish.
+            rawForecastHour = {};
+        }
 
-                    pWx.totalSnow = pPreviousWx.totalSnow;
-                    if(pWx.snowDepth > pPreviousWx.snowDepth)
-                        pWx.totalSnow += (pWx.snowDepth - pPreviousWx.snowDepth);
-                }
-            }
+        //Each hour's stats are already in point order, so they just go end to end.
+        vector<EnsembleStats> ensembleStats;
+        for(size_t i = firstHour; i < ensembleHourStats.size(); i++)
+        {
+            ensembleStats.insert(ensembleStats.end(), ensembleHourStats[i].begin(), ensembleHourStats[i].end());
+            ensembleHourStats[i] = {};
         }
 
-        return new GribData(validIndexes, quads, geoCoordLookup, wxResults);
+        vector<GeoCoord> coords(numberOfPoints);
+        for(size_t point = 0; point < numberOfPoints; point++)
+            coords[point] = geoCoords.at(validIndexes[point]);
+
+        vector<uint8_t> interpolatedFiles(interpolatedHours.begin() + firstHour, interpolatedHours.end());
+        return new GribData(numberOfFiles, validIndexes, std::move(coords), GribData::ToPointQuads(validIndexes, quads), std::move(fields), std::move(types), std::move(interpolatedFiles), std::move(ensembleStats));
     }
 
-    void GenerateForecast(unique_ptr<GribData>& gribData, unique_ptr<IForecastRepo>& forecastRepo)
+    //A location whose forecast is filled in as the hours come, and handed to the forecast repo once they're all in.
+    struct LocationForecast {
+        string key;
+        Location location;
+        DoublePoint homeCoords;
+        GeoCoordPoint nearPoints[4];
+        int32_t sunIndex;
+    };
+
+    vector<LocationForecast> StartLocationForecasts(unique_ptr<GribData>& gribData, size_t numberOfHours)
     {
         auto geoCoords = gribData->GetGeoCoords();
         auto pointSet = unique_ptr<IGeoPointSet>(AllocGeoPointSet(geoCoords, geoCalcs));        
-        cout << "Compiling JSON..." << endl;
-
-        {
-            auto forecastIndex = 0;
-            for(int32_t i = 0; i < gribData->GetNumberOfFiles(); i++)
-            {
-                auto imgSuffix = ToStringWithPad(3, '0', i);
-            }
-        }
+        vector<LocationForecast> locationForecasts(locations.size());
 
         #pragma omp parallel for
-        for(auto& kvp : locations)
+        for(size_t i = 0; i < locations.size(); i++)
         {
-            auto locationKey = get<0>(kvp);
-            auto location = get<1>(kvp);
-
-            GeoCoordPoint nearPoints[4] = {0};
-            Wx lastResult = {};
+            auto& locationForecast = locationForecasts[i];
+            auto& location = locationForecast.location;
+            locationForecast.key = get<0>(locations[i]);
+            location = get<1>(locations[i]);
 
-            auto homeCoords = geoCalcs.FindXY({location.coords.lat, location.coords.lon});
+            auto homeCoords = locationForecast.homeCoords = geoCalcs.FindXY({location.coords.lat, location.coords.lon});
             location.coords.x = static_cast<uint16_t>(round(homeCoords.x)); 
             location.coords.y = static_cast<uint16_t>(round(homeCoords.y));
 
-            pointSet->GetBoundingBox(location, nearPoints);
-            location.wxLen = gribData->GetNumberOfFiles();
+            pointSet->GetBoundingBox(location, locationForecast.nearPoints);
+            location.wxLen = numberOfHours;
             location.wx = static_cast<WxSingle*>(calloc(location.wxLen, sizeof(WxSingle)));
             location.sunsLen = totalDays;
             location.suns = static_cast<LabeledSun*>(calloc(location.sunsLen, sizeof(LabeledSun)));
+            locationForecast.sunIndex = -1;
+        }
+
+        return locationForecasts;
+    }
+
+    //gribData holds the hours starting at firstForecastIndex.
+    //Interpolated between the near points the same way as the rest of the location's wx.
+    void ForecastEnsembleStats(unique_ptr<GribData>& gribData, const GeoCoordPoint (&nearPoints)[4], const DoublePoint& homeCoords, int32_t fileIndex, WxSingle& wx)
+    {
+        const EnsembleStats* boundsStats[4];
+        for(auto k = 0; k < 4; k++)
+            boundsStats[k] = gribData->GetEnsembleStats(nearPoints[k].id, fileIndex);
+
+        //Parenthesized so it's the function and not the macro for one Wx property.
+        auto localStat = [&](auto stat) {
+            return (LocalForecast)(Vector2d { homeCoords.x, homeCoords.y }, LocalForecastPayload {
+                {
+                    { nearPoints[0].x, nearPoints[0].y },
+                    { nearPoints[1].x, nearPoints[1].y },
+                    { nearPoints[2].x, nearPoints[2].y },
+                    { nearPoints[3].x, nearPoints[3].y }
+                }, {
+                    stat(*boundsStats[0]),
+                    stat(*boundsStats[1]),
+                    stat(*boundsStats[2]),
+                    stat(*boundsStats[3])
+                }
+            });
+        };
+
+        wx.isEnsemble = true;
+        wx.precipitationChance = static_cast<uint8_t>(clamp(round(localStat([](auto& s) { return s.precipitationChance * 100.0; })), 0.0, 100.0));
+        wx.freezingChance = static_cast<uint8_t>(clamp(round(localStat([](auto& s) { return s.freezingChance * 100.0; })), 0.0, 100.0));
+        wx.temperature10th = static_cast<int16_t>(localStat([](auto& s) { return s.temperature[TenthPercentile]; }));
+        wx.temperature90th = static_cast<int16_t>(localStat([](auto& s) { return s.temperature[NinetiethPercentile]; }));
+        wx.newPrecipitation10th = max(0.0, localStat([](auto& s) { return s.newPrecipitation[TenthPercentile]; }));
+        wx.newPrecipitation90th = max(0.0, localStat([](auto& s) { return s.newPrecipitation[NinetiethPercentile]; }));
+    }
+
+    void ForecastLocations(vector<LocationForecast>& locationForecasts, unique_ptr<GribData>& gribData, int32_t firstForecastIndex)
+    {
+        #pragma omp parallel for
+        for(auto& locationForecast : locationForecasts)
+        {
+            auto& locationKey = locationForecast.key;
+            auto& location = locationForecast.location;
+            auto& nearPoints = locationForecast.nearPoints;
+            auto& homeCoords = locationForecast.homeCoords;
+            auto& sunIndex = locationForecast.sunIndex;
 
-            auto sunIndex = -1;
-            for(int32_t forecastIndex = 0; forecastIndex < location.wxLen; forecastIndex++)
+            for(int32_t fileIndex = 0; fileIndex < static_cast<int32_t>(gribData->GetNumberOfFiles()); fileIndex++)
             {
+                auto forecastIndex = firstForecastIndex + fileIndex;
                 auto forecastTime = localForecastTimes[forecastIndex];
                 auto currentDay = ToLocalTm(forecastTime).tm_mday;
                 if(sunIndex == -1 || location.suns[sunIndex].day != currentDay)
@@ -411,7 +1155,7 @@ private:
                 PrecipitationType typesSeen = PrecipitationType::NoPrecipitation;
                 for(auto k = 0; k < 4; k++)
                 {
-                    boundsWx[k] = gribData->GetWxAtGeoCoord(nearPoints[k], forecastIndex).wx;
+                    boundsWx[k] = gribData->GetWx(nearPoints[k].id, fileIndex);
                     typesSeen |= boundsWx[k].type;
                 }
                 
@@ -450,24 +1194,43 @@ private:
                     .temperature = static_cast<int16_t>(result.temperature),
                     .totalCloudCover = static_cast<uint16_t>(result.totalCloudCover),
                     .totalPrecipitation = max(0.0, result.totalPrecipitation),
-                    .totalSnow = result.totalSnow = max(lastResult.totalSnow, result.totalSnow),
+                    //Already never drops at any grid point, so it can't drop in between them either.
+                    .totalSnow = max(0.0, result.totalSnow),
                     .visibility = static_cast<uint16_t>(result.visibility),
                     .windDirection = static_cast<uint16_t>(result.WindDirection()),
                     .windSpeed = static_cast<uint16_t>(wxModel == WeatherModel::HRRR ? result.windSpeed : result.WindSpeed())
                 };
 
-                lastResult = result;
+                if(gribData->IsEnsemble())
+                    ForecastEnsembleStats(gribData, nearPoints, homeCoords, fileIndex, location.wx[forecastIndex]);
             }
-            
-            forecastRepo->AddLocation(locationKey, location);
-            free(location.wx);
-            free(location.suns);
         }
     }
 
+    //Each location's wx goes into the forecast repo from firstForecastIndex on.
+    void FinishLocationForecasts(vector<LocationForecast>& locationForecasts, unique_ptr<IForecastRepo>& forecastRepo, uint32_t firstForecastIndex = 0)
+    {
+        cout << "Compiling JSON..." << endl;
+
+        #pragma omp parallel for
+        for(auto& locationForecast : locationForecasts)
+        {
+            forecastRepo->AddLocation(locationForecast.key, locationForecast.location, firstForecastIndex);
+            free(locationForecast.location.wx);
+            free(locationForecast.location.suns);
+        }
+    }
+
+    void GenerateForecast(unique_ptr<GribData>& gribData, unique_ptr<IForecastRepo>& forecastRepo)
+    {
+        auto locationForecasts = StartLocationForecasts(gribData, gribData->GetNumberOfFiles());
+        ForecastLocations(locationForecasts, gribData, 0);
+        FinishLocationForecasts(locationForecasts, forecastRepo);
+    }
+
 public:
-    GribReader(string gribPathTemplate, const SelectedRegion& selectedRegion, WeatherModel wxModel, system_clock::time_point forecastStartTime, uint16_t skipToGribNumber, uint16_t maxGribIndex, GeographicCalcs& geoCalcs) 
-        : gribPathTemplate(gribPathTemplate), geoBounds(selectedRegion.GetRegionBoundsWithOverflow()), locations(selectedRegion.GetAllLocations()), wxModel(wxModel), forecastStartTime(forecastStartTime), skipToGribNumber(skipToGribNumber), maxGribIndex(maxGribIndex), totalDays(0), geoCalcs(geoCalcs)
+    GribReader(string gribPathTemplate, const SelectedRegion& selectedRegion, system_clock::time_point forecastStartTime, uint16_t skipToGribNumber, uint16_t maxGribIndex, GeographicCalcs& geoCalcs, GribReadModes readModes) 
+        : readModes(readModes), gribPathTemplate(gribPathTemplate), geoBounds(selectedRegion.GetRegionBoundsWithOverflow()), locations(selectedRegion.GetAllLocations()), forecastStartTime(forecastStartTime), skipToGribNumber(skipToGribNumber), maxGribIndex(maxGribIndex), totalDays(0), geoCalcs(geoCalcs)
     {
         if(this->geoBounds.leftLon < 0)
             this->geoBounds.leftLon += 360;
@@ -478,15 +1241,347 @@ public:
 
     void CollectData(unique_ptr<IForecastRepo>& forecastRepo, std::unique_ptr<GribData>& gribData)
     {
-        Initalize(forecastRepo);
+        BoundedQueue<LandedGrib> gribsOnDisk(maxGribIndex - skipToGribNumber + 1);
+        FOR_FORECASTS_IN_RANGE(i)
+        {
+            if(fs::exists(GetGribPath(i)))
+                gribsOnDisk.Push({ i, nullptr });
+        }
+
+        gribsOnDisk.Close();
+        CollectData(forecastRepo, gribData, gribsOnDisk, 0);
+    }
+
+    void CollectData(unique_ptr<IForecastRepo>& forecastRepo, std::unique_ptr<GribData>& gribData, BoundedQueue<LandedGrib>& landedGribs, uint16_t decodeThreads)
+    {
+        Initalize(forecastRepo, landedGribs, decodeThreads);
         gribData = unique_ptr<GribData>(GetCompiledGribData());
         GenerateForecast(gribData, forecastRepo);
 
         cout << "Done collecting Grib data!" << endl;
     }
+
+    void CollectTiledData(unique_ptr<IForecastRepo>& forecastRepo, uint16_t tileRows, uint16_t tileColumns, function<void(unique_ptr<GribData>&)> onTile)
+    {
+        auto gribNumbers = GetGribNumbersOnDisk();
+        PrepareFromFirstMessageOfFile(GetGribPath(gribNumbers.front()), [&](codes_handle* h) { ReadGridDefinition(h); });
+        if(!grid.IsSupported())
+            ERR_OUT("Tiles need a grid that GridDefinition can work with.");
+
+        GridCellRange regionCells = {};
+        if(!grid.GetCellRangeForBounds(geoBounds, regionCells.firstColumn, regionCells.lastColumn, regionCells.firstRow, regionCells.lastRow))
+            ERR_OUT("Selected region is outside of the grid.");
+
+        int32_t regionColumns = regionCells.lastColumn - regionCells.firstColumn + 1, regionRows = regionCells.lastRow - regionCells.firstRow + 1;
+        int32_t columnsOfTiles = clamp<int32_t>(tileColumns, 1, regionColumns), rowsOfTiles = clamp<int32_t>(tileRows, 1, regionRows);
+
+        //Each location goes to the tile holding the cell it's in, so it's only forecast once, and from a tile that has every point around it.
+        auto allLocations = locations;
+        vector<vector<tuple<string, Location>>> tileLocations(columnsOfTiles * rowsOfTiles);
+        for(auto& location : allLocations)
+        {
+            double column = 0, row = 0;
+            auto& coords = get<1>(location).coords;
+            grid.ToGridPoint({ coords.lat, coords.lon }, column, row);
+
+            auto tileColumn = (clamp<int32_t>(floor(column), regionCells.firstColumn, regionCells.lastColumn) - regionCells.firstColumn) * columnsOfTiles / regionColumns;
+            auto tileRow = (clamp<int32_t>(floor(row), regionCells.firstRow, regionCells.lastRow) - regionCells.firstRow) * rowsOfTiles / regionRows;
+            tileLocations[tileRow * columnsOfTiles + tileColumn].push_back(location);
+        }
+
+        tiled = true;
+        for(auto tileRow = 0; tileRow < rowsOfTiles; tileRow++)
+        for(auto tileColumn = 0; tileColumn < columnsOfTiles; tileColumn++)
+        {
+            auto tileIndex = tileRow * columnsOfTiles + tileColumn;
+            tileCells = {
+                .firstColumn = regionCells.firstColumn + regionColumns * tileColumn / columnsOfTiles,
+                .lastColumn = regionCells.firstColumn + regionColumns * (tileColumn + 1) / columnsOfTiles - 1,
+                .firstRow = regionCells.firstRow + regionRows * tileRow / rowsOfTiles,
+                .lastRow = regionCells.firstRow + regionRows * (tileRow + 1) / rowsOfTiles - 1
+            };
+            haloCells = tileCells.Grow(1);
+
+            cout << "Tile " << (tileIndex + 1) << " of " << tileLocations.size() << ": columns " << tileCells.firstColumn << "-" << tileCells.lastColumn 
+                << ", rows " << tileCells.firstRow << "-" << tileCells.lastRow << ", " << tileLocations[tileIndex].size() << " locations." << endl;
+
+            validIndexes.clear();
+            geoCoords.clear();
+            geoCoordLookup.clear();
+            quads.clear();
+            rawFieldData.clear();
+            locations = std::move(tileLocations[tileIndex]);
+
+            BoundedQueue<LandedGrib> gribsOnDisk(gribNumbers.size());
+            for(auto& gribNumber : gribNumbers)
+                gribsOnDisk.Push({ gribNumber, nullptr });
+
+            gribsOnDisk.Close();
+            Initalize(forecastRepo, gribsOnDisk, 0);
+
+            auto tileData = unique_ptr<GribData>(GetCompiledGribData());
+            GenerateForecast(tileData, forecastRepo);
+            onTile(tileData);
+        }
+
+        tiled = false;
+        locations = std::move(allLocations);
+
+        cout << "Done collecting Grib data!" << endl;
+    }
+
+    void CollectStreamedData(unique_ptr<IForecastRepo>& forecastRepo, size_t memoryBudget, function<void(unique_ptr<GribData>&, int32_t)> onHours)
+    {
+        RequireOneStepPerFile("Streaming");
+        vector<uint8_t> interpolated;
+        auto gribNumbers = WithMissingHours(GetGribNumbersOnDisk(), interpolated);
+        PrepareParallelDataBasedOffOfFile(GetGribPath(gribNumbers.front()));
+        AddForecastStartTimes(forecastRepo, gribNumbers);
+
+        //An hour's raw columns, and then its compiled ones, for every point in the region.
+        auto bytesPerHour = max<size_t>(1, validIndexes.size() * (GribFieldCount * (sizeof(double) + sizeof(float)) + sizeof(int32_t) + sizeof(PrecipitationType)));
+        auto windowHours = max<size_t>(2, memoryBudget / bytesPerHour);
+        cout << "Streaming " << gribNumbers.size() << " hours, " << (windowHours - 1) << " at a time, " << ToStringWithPrecision(1, bytesPerHour / (1024.0 * 1024.0)) << " MB each..." << endl;
+
+        vector<LocationForecast> locationForecasts;
+        for(size_t next = 0; next < gribNumbers.size(); )
+        {
+            //After the first window, rawFieldData starts out holding the hour before this one, already derived, for the derivations to carry on from.
+            auto carried = rawFieldData.size();
+            auto count = min(windowHours - carried, gribNumbers.size() - next);
+
+            //A window can't end on an interpolated hour, since the hour after it is what it's interpolated toward.
+            while(interpolated[next + count - 1])
+                count++;
+
+            rawFieldData.resize(carried + count);
+            interpolatedHours.assign(carried, false);
+            interpolatedHours.insert(interpolatedHours.end(), interpolated.begin() + next, interpolated.begin() + next + count);
+
+            #pragma omp parallel for
+            for(size_t i = 0; i < count; i++)
+            {
+                if(!interpolated[next + i])
+                    ReadGribFile(GetGribPath(gribNumbers[next + i]), rawFieldData[carried + i]);
+            }
+
+            vector<uint16_t> windowNumbers(gribNumbers.begin() + next - carried, gribNumbers.begin() + next + count);
+            InterpolateMissingHours(windowNumbers);
+            DeriveTemporalFields(wxModel, rawFieldData, validIndexes.size());
+
+            auto window = unique_ptr<GribData>(CompileRawHours(carried));
+            //Compiled, so the last hour can be moved out to carry into the next window instead of copied.
+            auto lastHour = std::move(rawFieldData.back());
+            if(!next)
+                locationForecasts = StartLocationForecasts(window, gribNumbers.size());
+
+            ForecastLocations(locationForecasts, window, next);
+            onHours(window, next);
+
+            rawFieldData.clear();
+            rawFieldData.push_back(std::move(lastHour));
+            next += count;
+        }
+
+        rawFieldData.clear();
+        interpolatedHours.clear();
+        FinishLocationForecasts(locationForecasts, forecastRepo);
+
+        cout << "Done collecting Grib data!" << endl;
+    }
+
+    void CollectEnsembleData(unique_ptr<IForecastRepo>& forecastRepo, const vector<string>& memberPathTemplates, unique_ptr<GribData>& gribData)
+    {
+        RequireOneStepPerFile("An ensemble");
+        auto gribNumbers = GetGribNumbersOnDisk();
+        PrepareParallelDataBasedOffOfFile(GetGribPath(gribNumbers.front()));
+        AddForecastStartTimes(forecastRepo, gribNumbers);
+
+        //Each member's last hour, already derived, for the derivations to carry on from.
+        vector<RawForecastHour> latestHours(memberPathTemplates.size());
+        for(size_t hour = 0; hour < gribNumbers.size(); hour++)
+        {
+            cout << "Reading hour " << gribNumbers[hour] << " of " << memberPathTemplates.size() << " ensemble members..." << endl;
+
+            #pragma omp parallel for schedule(dynamic)
+            for(size_t member = 0; member < memberPathTemplates.size(); member++)
+            {
+                vector<RawForecastHour> window;
+                if(hour)
+                    window.push_back(std::move(latestHours[member]));
+
+                window.emplace_back();
+                ReadGribFile(GetGribPath(memberPathTemplates[member], gribNumbers[hour]), window.back());
+                DeriveTemporalFields(wxModel, window, validIndexes.size());
+                latestHours[member] = std::move(window.back());
+            }
+
+            rawFieldData.emplace_back();
+            ensembleHourStats.emplace_back();
+            ReduceEnsembleHour(latestHours, validIndexes.size(), rawFieldData.back(), ensembleHourStats.back());
+        }
+
+        //Already derived, member by member, so this skips GetCompiledGribData.
+        gribData = unique_ptr<GribData>(CompileRawHours(0));
+        GenerateForecast(gribData, forecastRepo);
+
+        rawFieldData.clear();
+        ensembleHourStats.clear();
+
+        cout << "Done collecting Grib data!" << endl;
+    }
+
+    system_clock::time_point GetForecastStartTime() { return forecastStartTime; }
+
+    void ReadHoursOnto(const vector<GeoCoord>& points, vector<uint16_t>& gribNumbers, vector<RawForecastHour>& regriddedHours, vector<uint8_t>& interpolated)
+    {
+        gribNumbers = ReadDerivedHoursOnDisk();
+        if(!grid.IsSupported())
+            ERR_OUT("Regridding needs a grid that GridDefinition can work with.");
+
+        cout << "Regridding " << gribNumbers.size() << " hours onto " << points.size() << " points..." << endl;
+        auto stencils = BuildRegridStencils(grid, validIndexes, points);
+
+        regriddedHours.resize(gribNumbers.size());
+        for(size_t hour = 0; hour < gribNumbers.size(); hour++)
+        {
+            RegridHour(rawFieldData[hour], stencils, regriddedHours[hour]);
+            rawFieldData[hour] = {};
+        }
+
+        interpolated = std::move(interpolatedHours);
+        rawFieldData.clear();
+        interpolatedHours.clear();
+    }
+
+    void CollectBlendedData(unique_ptr<IForecastRepo>& forecastRepo, IGribReader& laterReader, uint16_t fadeStartHour, uint16_t fadeEndHour, unique_ptr<GribData>& gribData)
+    {
+        auto earlierNumbers = ReadDerivedHoursOnDisk();
+        auto earlierHours = std::move(rawFieldData);
+        auto earlierInterpolated = std::move(interpolatedHours);
+        rawFieldData.clear();
+        interpolatedHours.clear();
+
+        vector<GeoCoord> points(validIndexes.size());
+        for(size_t point = 0; point < validIndexes.size(); point++)
+            points[point] = geoCoords.at(validIndexes[point]);
+
+        vector<uint16_t> laterNumbers;
+        vector<RawForecastHour> laterHours;
+        vector<uint8_t> laterInterpolated;
+        laterReader.ReadHoursOnto(points, laterNumbers, laterHours, laterInterpolated);
+
+        //Hours are counted from this model's start. The later model is usually the older run, so its hours land a few earlier than its own numbers.
+        auto laterOffset = static_cast<int32_t>(duration_cast<hours>(laterReader.GetForecastStartTime() - forecastStartTime).count());
+
+        map<int32_t, size_t> earlierAt, laterAt;
+        set<int32_t> timeline;
+        for(size_t i = 0; i < earlierNumbers.size(); i++)
+        {
+            earlierAt[earlierNumbers[i]] = i;
+            if(GetLaterModelWeight(earlierNumbers[i], fadeStartHour, fadeEndHour) < 1)
+                timeline.insert(earlierNumbers[i]);
+        }
+
+        for(size_t i = 0; i < laterNumbers.size(); i++)
+        {
+            auto hour = laterNumbers[i] + laterOffset;
+            laterAt[hour] = i;
+            if(hour >= 0 && hour <= UINT16_MAX && GetLaterModelWeight(hour, fadeStartHour, fadeEndHour) > 0)
+                timeline.insert(hour);
+        }
+
+        if(timeline.empty())
+            ERR_OUT("Neither model has any hours to blend.");
+
+        cout << "Blending " << timeline.size() << " hours, fading between hours " << fadeStartHour << " and " << fadeEndHour << "..." << endl;
+        vector<uint16_t> blendedNumbers;
+        rawFieldData.reserve(timeline.size());
+        for(auto hour : timeline)
+        {
+            BlendedHourSources sources = { .laterWeight = GetLaterModelWeight(hour, fadeStartHour, fadeEndHour) };
+            auto earlier = earlierAt.find(hour), later = laterAt.find(hour);
+            auto earlierWasInterpolated = true, laterWasInterpolated = true;
+
+            if(earlier != earlierAt.end() && sources.laterWeight < 1)
+            {
+                sources.earlier = &earlierHours[earlier->second];
+                sources.earlierPrevious = earlier->second ? &earlierHours[earlier->second - 1] : nullptr;
+                earlierWasInterpolated = earlierInterpolated[earlier->second];
+            }
+
+            if(later != laterAt.end() && sources.laterWeight > 0)
+            {
+                sources.later = &laterHours[later->second];
+                sources.laterPrevious = later->second ? &laterHours[later->second - 1] : nullptr;
+                laterWasInterpolated = laterInterpolated[later->second];
+            }
+
+            rawFieldData.emplace_back();
+            BlendHour(sources, rawFieldData.size() > 1 ? &rawFieldData[rawFieldData.size() - 2] : nullptr, validIndexes.size(), rawFieldData.back());
+            interpolatedHours.push_back(earlierWasInterpolated && laterWasInterpolated);
+            blendedNumbers.push_back(static_cast<uint16_t>(hour));
+        }
+
+        earlierHours.clear();
+        laterHours.clear();
+        AddForecastStartTimes(forecastRepo, blendedNumbers);
+
+        //Each model was derived on its own, and the blend carries the totals on itself, so this skips GetCompiledGribData.
+        gribData = unique_ptr<GribData>(CompileRawHours(0));
+        GenerateForecast(gribData, forecastRepo);
+
+        rawFieldData.clear();
+        interpolatedHours.clear();
+
+        cout << "Done collecting Grib data!" << endl;
+    }
+
+    void CollectAppendedData(unique_ptr<IForecastRepo>& forecastRepo, GribData& existing, unique_ptr<GribData>& gribData)
+    {
+        RequireOneStepPerFile("Appending");
+        auto gribNumbers = GetGribNumbersOnDisk();
+        if(gribNumbers.size() < 2 || gribNumbers.front() != skipToGribNumber)
+            ERR_OUT("Appending needs hour " << skipToGribNumber << ", the last one already read, and at least one after it on disk.");
+
+        PrepareParallelDataBasedOffOfFile(GetGribPath(gribNumbers.front()));
+        cout << "Appending hours " << gribNumbers[1] << "-" << gribNumbers.back() << " after forecast index " << (existing.GetNumberOfFiles() - 1) << "..." << endl;
+
+        rawFieldData.resize(gribNumbers.size());
+        #pragma omp parallel for
+        for(size_t i = 0; i < gribNumbers.size(); i++)
+            ReadGribFile(GetGribPath(gribNumbers[i]), rawFieldData[i]);
+
+        CarryOnFrom(existing, rawFieldData.front());
+        DeriveTemporalFields(wxModel, rawFieldData, validIndexes.size());
+        interpolatedHours.assign(rawFieldData.size(), false);
+
+        gribNumbers.erase(gribNumbers.begin());
+        AddForecastStartTimes(forecastRepo, gribNumbers);
+        gribData = unique_ptr<GribData>(CompileRawHours(1));
+
+        auto locationForecasts = StartLocationForecasts(gribData, gribData->GetNumberOfFiles());
+        ForecastLocations(locationForecasts, gribData, 0);
+        FinishLocationForecasts(locationForecasts, forecastRepo, existing.GetNumberOfFiles());
+
+        rawFieldData.clear();
+        interpolatedHours.clear();
+
+        cout << "Done collecting Grib data!" << endl;
+    }
 };
 
-IGribReader* AllocGribReader(string gribPathTemplate, const SelectedRegion& selectedRegion, WeatherModel wxModel, system_clock::time_point forecastStartTime, uint16_t skipToGribNumber, uint16_t maxGribIndex, GeographicCalcs& geoCalcs)
+IGribReader* AllocGribReader(string gribPathTemplate, const SelectedRegion& selectedRegion, WeatherModel wxModel, system_clock::time_point forecastStartTime, uint16_t skipToGribNumber, uint16_t maxGribIndex, GeographicCalcs& geoCalcs, GribReadModes readModes)
 {
-    return new GribReader(gribPathTemplate, selectedRegion, wxModel, forecastStartTime, skipToGribNumber, maxGribIndex, geoCalcs);
+    switch(wxModel)
+    {
+        case WeatherModel::HRRR:
+            return new GribReader<WeatherModel::HRRR>(gribPathTemplate, selectedRegion, forecastStartTime, skipToGribNumber, maxGribIndex, geoCalcs, readModes);
+        case WeatherModel::GFS:
+            return new GribReader<WeatherModel::GFS>(gribPathTemplate, selectedRegion, forecastStartTime, skipToGribNumber, maxGribIndex, geoCalcs, readModes);
+        case WeatherModel::GEFS:
+            return new GribReader<WeatherModel::GEFS>(gribPathTemplate, selectedRegion, forecastStartTime, skipToGribNumber, maxGribIndex, geoCalcs, readModes);
+        default:
+            ERR_OUT("Unsupported WeatherModel")
+    }
 }
\ No newline at end of file
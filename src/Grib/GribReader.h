@@ -1,20 +1,61 @@
 #pragma once
 
+#include "BoundedQueue.h"
 #include "Data/ForecastRepo.h"
 #include "Geography/Geo.h"
 #include "Grib.h"
+#include "GribBuffer.h"
 #include "GribData.h"
 #include "Wx.h"
 
 #include <chrono>
+#include <functional>
 #include <string>
 #include <vector>
 
+enum GribReadModes {
+    DefaultGribReadMode = 0,
+    //mmap each GRIB file and make handles right out of the mapping, instead of eccodes copying every message out of a FILE*.
+    MappedGribReadMode = (1 << 0),
+    //Decode simple and complex packing with GribUnpacker, only at the points in the region, and leave the rest to eccodes.
+    NativeUnpackGribReadMode = (1 << 1),
+    //Decode with both and stop on the first value that doesn't match to the bit.
+    ValidateUnpackGribReadMode = (1 << 2),
+    //Fill in every published hour between the first and last one read that wasn't downloaded, from the hours on either side of it.
+    InterpolateMissingHoursGribReadMode = (1 << 3),
+    //HRRR's wrfsubhf files, which hold four 15 minute steps each after the first. Every step becomes its own forecast time.
+    //Only CollectData and CollectTiledData read more than one step per file.
+    SubHourlyGribReadMode = (1 << 4)
+};
+
 class IGribReader
 {
 public:
     virtual void CollectData(std::unique_ptr<IForecastRepo>& forecastRepo, std::unique_ptr<GribData>& gribData) = 0;
+    //Reads each hour as it's pushed, until the queue is closed, so decoding can start while the downloads are still running.
+    //Hours that come with a buffer are decoded right out of it, and released once read.
+    virtual void CollectData(std::unique_ptr<IForecastRepo>& forecastRepo, std::unique_ptr<GribData>& gribData, BoundedQueue<LandedGrib>& landedGribs, uint16_t decodeThreads) = 0;
+    //Splits the region into tiles and runs each through the whole pipeline on its own, reading every hour from disk again per tile,
+    //so only one tile's hours are ever held at once. Each tile's GribData is handed to onTile, and gone once it returns.
+    virtual void CollectTiledData(std::unique_ptr<IForecastRepo>& forecastRepo, uint16_t tileRows, uint16_t tileColumns, std::function<void(std::unique_ptr<GribData>&)> onTile) = 0;
+    //Reads the hours in order, a window at a time, sized so the hours held at once fit in memoryBudget bytes. Each window's hours are handed
+    //to onHours, along with the forecast index of the first, and gone once it returns. Only the last hour is carried into the next window.
+    virtual void CollectStreamedData(std::unique_ptr<IForecastRepo>& forecastRepo, size_t memoryBudget, std::function<void(std::unique_ptr<GribData>&, int32_t)> onHours) = 0;
+    //Reads every member's hours, one forecast hour at a time with the members in parallel, and reduces them down as it goes, so no more than
+    //the hour being read and the one before it are ever held per member. The reader's own path template has to be one of memberPathTemplates.
+    virtual void CollectEnsembleData(std::unique_ptr<IForecastRepo>& forecastRepo, const std::vector<std::string>& memberPathTemplates, std::unique_ptr<GribData>& gribData) = 0;
+    //Reads every hour on disk, derived, and regridded onto points, which are usually some other reader's. Regridding is bilinear,
+    //with the stencils worked out once and shared by every hour. gribNumbers and interpolated line up with hours.
+    virtual void ReadHoursOnto(const std::vector<GeoCoord>& points, std::vector<uint16_t>& gribNumbers, std::vector<RawForecastHour>& hours, std::vector<uint8_t>& interpolated) = 0;
+    //One timeline on this reader's points: its own hours through fadeStartHour, laterReader's from fadeEndHour on, and a cross-fade
+    //between the two in between. Hours are counted from this reader's forecast start. Every blended hour goes into a single gribData.
+    virtual void CollectBlendedData(std::unique_ptr<IForecastRepo>& forecastRepo, IGribReader& laterReader, uint16_t fadeStartHour, uint16_t fadeEndHour, std::unique_ptr<GribData>& gribData) = 0;
+    //Adds the hours after this reader's first on to a forecast that was already read, whose last hour has to be that first one. It's only read
+    //again for the derivations to carry on from, along with what they'd added up to in existing. The new hours go on the end of every location
+    //already in forecastRepo, and into gribData on their own.
+    virtual void CollectAppendedData(std::unique_ptr<IForecastRepo>& forecastRepo, GribData& existing, std::unique_ptr<GribData>& gribData) = 0;
+    virtual std::chrono::system_clock::time_point GetForecastStartTime() = 0;
     virtual ~IGribReader() = default;
 };
 
-IGribReader* AllocGribReader(std::string gribPathTemplate, const SelectedRegion& selectedRegion, WeatherModel wxModel, std::chrono::system_clock::time_point forecastStartTime, uint16_t skipToGribNumber, uint16_t maxGribIndex, GeographicCalcs& geoCalcs);
\ No newline at end of file
+IGribReader* AllocGribReader(std::string gribPathTemplate, const SelectedRegion& selectedRegion, WeatherModel wxModel, std::chrono::system_clock::time_point forecastStartTime, uint16_t skipToGribNumber, uint16_t maxGribIndex, GeographicCalcs& geoCalcs, GribReadModes readModes = DefaultGribReadMode);
\ No newline at end of file
@@ -0,0 +1,429 @@
+#include "GribUnpacker.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+//Scratch space for complex packing, kept per decode thread.
+thread_local vector<int64_t> unpackedIntegers;
+thread_local vector<uint8_t> unpackedMissing;
+thread_local vector<double> unpackedValues;
+thread_local vector<uint32_t> bitmapPrefix;
+thread_local vector<int64_t> groupReferences, groupWidths, groupLengths;
+
+struct GribDataSections {
+    const uint8_t *section3 = nullptr, *section5 = nullptr, *section6 = nullptr, *section7 = nullptr;
+    size_t section3Length = 0, section5Length = 0, section6Length = 0, section7Length = 0;
+};
+
+inline uint64_t ReadUnsigned(const uint8_t* bytes, int32_t count)
+{
+    uint64_t value = 0;
+    for(auto i = 0; i < count; i++)
+        value = (value << 8) | bytes[i];
+
+    return value;
+}
+
+//GRIB2 signed integers are sign and magnitude, not two's complement.
+inline int64_t ReadSigned(const uint8_t* bytes, int32_t count)
+{
+    auto value = ReadUnsigned(bytes, count);
+    auto signBit = 1ull << (count * 8 - 1);
+    return value & signBit ? -static_cast<int64_t>(value & ~signBit) : static_cast<int64_t>(value);
+}
+
+inline double ReadIeeeFloat(const uint8_t* bytes)
+{
+    auto bits = static_cast<uint32_t>(ReadUnsigned(bytes, 4));
+    float value = 0;
+    memcpy(&value, &bits, sizeof(float));
+    return value;
+}
+
+//Same as eccodes' grib_power, one step at a time, so the scale factors match it to the last bit.
+inline double Power(int64_t exponent, int64_t base)
+{
+    double result = 1.0;
+    while(exponent < 0)
+    {
+        result /= base;
+        exponent++;
+    }
+
+    while(exponent > 0)
+    {
+        result *= base;
+        exponent--;
+    }
+
+    return result;
+}
+
+//Big endian bit stream, the way GRIB packs everything. Reads are at most 32 bits.
+class BitReader
+{
+private:
+    const uint8_t* data;
+    uint64_t lengthInBits, position = 0;
+
+public:
+    BitReader(const uint8_t* data, size_t length) : data(data), lengthInBits(length * 8) {}
+
+    inline bool CanRead(uint64_t bits) const { return position + bits <= lengthInBits; }
+    inline void Seek(uint64_t bit) { position = bit; }
+    inline void AlignToByte() { position = (position + 7) & ~7ull; }
+
+    inline uint64_t Read(int32_t bits)
+    {
+        if(!bits)
+            return 0;
+
+        auto byte = position >> 3;
+        auto shift = static_cast<int32_t>(position & 7);
+        auto bytesNeeded = (shift + bits + 7) >> 3;
+
+        uint64_t value = 0;
+        for(auto i = 0; i < bytesNeeded; i++)
+            value = (value << 8) | data[byte + i];
+
+        position += bits;
+        return (value >> (bytesNeeded * 8 - shift - bits)) & ((1ull << bits) - 1);
+    }
+};
+
+static bool FindDataSections(const uint8_t* message, size_t messageLength, GribDataSections& sections)
+{
+    if(messageLength < 16 || memcmp(message, "GRIB", 4) || message[7] != 2)
+        return false;
+
+    size_t offset = 16;
+    while(offset + 5 <= messageLength && memcmp(message + offset, "7777", 4))
+    {
+        auto length = ReadUnsigned(message + offset, 4);
+        auto number = message[offset + 4];
+        if(length < 5 || offset + length > messageLength)
+            return false;
+
+        switch(number)
+        {
+            case 3:
+                sections.section3 = message + offset;
+                sections.section3Length = length;
+                break;
+            case 4:
+                //A second field in the same message. eccodes' handle is only the first one, and so is this.
+                if(sections.section7)
+                    return sections.section3 && sections.section5 && sections.section6;
+                break;
+            case 5:
+                sections.section5 = message + offset;
+                sections.section5Length = length;
+                break;
+            case 6:
+                sections.section6 = message + offset;
+                sections.section6Length = length;
+                break;
+            case 7:
+                sections.section7 = message + offset;
+                sections.section7Length = length;
+                break;
+        }
+
+        offset += length;
+    }
+
+    return sections.section3 && sections.section5 && sections.section6 && sections.section7;
+}
+
+//Maps a grid point to where it sits among the coded values, or -1 if the bitmap says it's missing.
+class CodedIndexes
+{
+private:
+    const uint8_t* bitmap = nullptr;
+
+public:
+    bool Init(const GribDataSections& sections, uint32_t numberOfGridPoints, uint32_t numberOfCodedValues)
+    {
+        auto indicator = sections.section6[5];
+        if(indicator == 255)
+            return numberOfCodedValues == numberOfGridPoints;
+
+        //254 reuses a bitmap from an earlier field, which only eccodes is keeping track of.
+        if(indicator != 0 || sections.section6Length < 6 + (numberOfGridPoints + 7) / 8)
+            return false;
+
+        bitmap = sections.section6 + 6;
+        auto bitmapBytes = (numberOfGridPoints + 7) / 8;
+        bitmapPrefix.resize(bitmapBytes);
+
+        uint32_t count = 0;
+        for(uint32_t i = 0; i < bitmapBytes; i++)
+        {
+            bitmapPrefix[i] = count;
+            count += __builtin_popcount(bitmap[i]);
+        }
+
+        return count >= numberOfCodedValues;
+    }
+
+    inline int64_t operator[](int32_t gridIndex) const
+    {
+        if(!bitmap)
+            return gridIndex;
+
+        auto byte = bitmap[gridIndex >> 3];
+        auto bit = gridIndex & 7;
+        if(!(byte & (0x80 >> bit)))
+            return -1;
+
+        return bitmapPrefix[gridIndex >> 3] + __builtin_popcount(byte >> (8 - bit));
+    }
+};
+
+static bool UnpackSimple(const GribDataSections& sections, uint32_t numberOfCodedValues, const CodedIndexes& codedIndexes,
+    const int32_t* indexes, size_t numberOfIndexes, double missingValue, double* values)
+{
+    auto section5 = sections.section5;
+    auto reference = ReadIeeeFloat(section5 + 11);
+    auto bscale = Power(ReadSigned(section5 + 15, 2), 2);
+    auto dscale = Power(-ReadSigned(section5 + 17, 2), 10);
+    int32_t bitsPerValue = section5[19];
+
+    if(bitsPerValue > 32)
+        return false;
+
+    BitReader reader(sections.section7 + 5, sections.section7Length - 5);
+    if(!reader.CanRead(static_cast<uint64_t>(numberOfCodedValues) * bitsPerValue))
+        return false;
+
+    for(size_t i = 0; i < numberOfIndexes; i++)
+    {
+        auto gridIndex = indexes[i];
+        auto codedIndex = codedIndexes[gridIndex];
+        if(codedIndex < 0 || codedIndex >= numberOfCodedValues)
+        {
+            values[gridIndex] = missingValue;
+            continue;
+        }
+
+        //eccodes hands back the reference value as is for a constant field, without the decimal scale.
+        if(!bitsPerValue)
+        {
+            values[gridIndex] = reference;
+            continue;
+        }
+
+        reader.Seek(static_cast<uint64_t>(codedIndex) * bitsPerValue);
+        auto packed = static_cast<double>(reader.Read(bitsPerValue));
+        values[gridIndex] = ((packed * bscale) + reference) * dscale;
+    }
+
+    return true;
+}
+
+//Complex packing, per Code Table 5.2/5.3 and the NCEP g2clib comunpack. Decodes every coded value into unpackedValues.
+static bool UnpackComplex(const GribDataSections& sections, int32_t templateNumber, uint32_t numberOfCodedValues, double missingValue)
+{
+    auto section5 = sections.section5;
+    if(sections.section5Length < (templateNumber == 3 ? 49u : 47u))
+        return false;
+
+    auto reference = ReadIeeeFloat(section5 + 11);
+    auto bscale = Power(ReadSigned(section5 + 15, 2), 2);
+    auto dscale = Power(-ReadSigned(section5 + 17, 2), 10);
+    int32_t bitsPerValue = section5[19];
+    int32_t missingManagement = section5[22];
+    auto numberOfGroups = static_cast<uint32_t>(ReadUnsigned(section5 + 31, 4));
+    int64_t widthReference = section5[35];
+    int32_t widthBits = section5[36];
+    auto lengthReference = static_cast<int64_t>(ReadUnsigned(section5 + 37, 4));
+    int64_t lengthIncrement = section5[41];
+    auto lastGroupLength = static_cast<int64_t>(ReadUnsigned(section5 + 42, 4));
+    int32_t lengthBits = section5[46];
+    int32_t order = templateNumber == 3 ? section5[47] : 0;
+    int32_t extraOctets = templateNumber == 3 ? section5[48] : 0;
+
+    if(bitsPerValue > 32 || widthBits > 32 || lengthBits > 32 || missingManagement > 2 || order > 2 || (order && (extraOctets < 1 || extraOctets > 4)))
+        return false;
+
+    auto data = sections.section7 + 5;
+    auto dataLength = sections.section7Length - 5;
+    BitReader reader(data, dataLength);
+
+    int64_t firstValue = 0, secondValue = 0, minimum = 0;
+    if(order)
+    {
+        auto descriptors = order + 1;
+        if(dataLength < static_cast<size_t>(descriptors * extraOctets))
+            return false;
+
+        firstValue = ReadSigned(data, extraOctets);
+        if(order == 2)
+            secondValue = ReadSigned(data + extraOctets, extraOctets);
+
+        minimum = ReadSigned(data + (descriptors - 1) * extraOctets, extraOctets);
+        reader.Seek(descriptors * extraOctets * 8);
+    }
+
+    groupReferences.resize(numberOfGroups);
+    groupWidths.resize(numberOfGroups);
+    groupLengths.resize(numberOfGroups);
+
+    if(!reader.CanRead(static_cast<uint64_t>(numberOfGroups) * bitsPerValue))
+        return false;
+    for(uint32_t g = 0; g < numberOfGroups; g++)
+        groupReferences[g] = reader.Read(bitsPerValue);
+    reader.AlignToByte();
+
+    if(!reader.CanRead(static_cast<uint64_t>(numberOfGroups) * widthBits))
+        return false;
+    for(uint32_t g = 0; g < numberOfGroups; g++)
+        groupWidths[g] = widthReference + reader.Read(widthBits);
+    reader.AlignToByte();
+
+    if(!reader.CanRead(static_cast<uint64_t>(numberOfGroups) * lengthBits))
+        return false;
+    for(uint32_t g = 0; g < numberOfGroups; g++)
+        groupLengths[g] = lengthReference + reader.Read(lengthBits) * lengthIncrement;
+    reader.AlignToByte();
+
+    if(numberOfGroups)
+        groupLengths[numberOfGroups - 1] = lastGroupLength;
+
+    uint64_t totalLength = 0, totalBits = 0;
+    for(uint32_t g = 0; g < numberOfGroups; g++)
+    {
+        if(groupWidths[g] > 32)
+            return false;
+
+        totalLength += groupLengths[g];
+        totalBits += groupLengths[g] * groupWidths[g];
+    }
+
+    if(totalLength != numberOfCodedValues || !reader.CanRead(totalBits))
+        return false;
+
+    unpackedIntegers.resize(numberOfCodedValues);
+    unpackedMissing.assign(missingManagement ? numberOfCodedValues : 0, 0);
+
+    //All ones (and with management 2, all ones less one) mark a missing value, in a group's width, or in the reference of a group with no width.
+    auto groupMissing = (1ll << bitsPerValue) - 1;
+    size_t n = 0;
+    for(uint32_t g = 0; g < numberOfGroups; g++)
+    {
+        auto width = static_cast<int32_t>(groupWidths[g]);
+        auto groupReference = groupReferences[g];
+        auto length = groupLengths[g];
+        auto valueMissing = (1ll << width) - 1;
+
+        if(!width)
+        {
+            auto missing = missingManagement && (groupReference == groupMissing || (missingManagement == 2 && groupReference == groupMissing - 1));
+            for(int64_t k = 0; k < length; k++, n++)
+            {
+                unpackedIntegers[n] = groupReference;
+                if(missing)
+                    unpackedMissing[n] = true;
+            }
+            continue;
+        }
+
+        for(int64_t k = 0; k < length; k++, n++)
+        {
+            auto packed = static_cast<int64_t>(reader.Read(width));
+            unpackedIntegers[n] = groupReference + packed;
+            if(missingManagement && (packed == valueMissing || (missingManagement == 2 && packed == valueMissing - 1)))
+                unpackedMissing[n] = true;
+        }
+    }
+
+    //Spatial differencing only ever ran over the values that aren't missing, so it gets undone over just those.
+    if(order)
+    {
+        int64_t previous = 0, beforePrevious = 0;
+        size_t seen = 0;
+        for(size_t i = 0; i < numberOfCodedValues; i++)
+        {
+            if(missingManagement && unpackedMissing[i])
+                continue;
+
+            auto& value = unpackedIntegers[i];
+            if(seen == 0)
+                value = firstValue;
+            else if(seen == 1 && order == 2)
+                value = secondValue;
+            else if(order == 1)
+                value = value + minimum + previous;
+            else
+                value = value + minimum + 2 * previous - beforePrevious;
+
+            beforePrevious = previous;
+            previous = value;
+            seen++;
+        }
+    }
+
+    unpackedValues.resize(numberOfCodedValues);
+    auto integers = unpackedIntegers.data();
+    auto result = unpackedValues.data();
+    #pragma omp simd
+    for(size_t i = 0; i < numberOfCodedValues; i++)
+        result[i] = ((static_cast<double>(integers[i]) * bscale) + reference) * dscale;
+
+    if(missingManagement)
+    {
+        for(size_t i = 0; i < numberOfCodedValues; i++)
+        {
+            if(unpackedMissing[i])
+                result[i] = missingValue;
+        }
+    }
+
+    return true;
+}
+
+bool UnpackGribValues(const uint8_t* message, size_t messageLength, const int32_t* indexes, size_t numberOfIndexes, double missingValue, double* values)
+{
+    GribDataSections sections;
+    if(!FindDataSections(message, messageLength, sections) || sections.section3Length < 10 || sections.section5Length < 21 || sections.section6Length < 6)
+        return false;
+
+    auto numberOfGridPoints = static_cast<uint32_t>(ReadUnsigned(sections.section3 + 6, 4));
+    auto numberOfCodedValues = static_cast<uint32_t>(ReadUnsigned(sections.section5 + 5, 4));
+    auto templateNumber = static_cast<int32_t>(ReadUnsigned(sections.section5 + 9, 2));
+
+    CodedIndexes codedIndexes;
+    if(!codedIndexes.Init(sections, numberOfGridPoints, numberOfCodedValues))
+        return false;
+
+    for(size_t i = 0; i < numberOfIndexes; i++)
+    {
+        if(indexes[i] < 0 || static_cast<uint32_t>(indexes[i]) >= numberOfGridPoints)
+            return false;
+    }
+
+    switch(templateNumber)
+    {
+        case 0:
+            return UnpackSimple(sections, numberOfCodedValues, codedIndexes, indexes, numberOfIndexes, missingValue, values);
+        case 2:
+        case 3:
+            break;
+        default:
+            return false;
+    }
+
+    if(!UnpackComplex(sections, templateNumber, numberOfCodedValues, missingValue))
+        return false;
+
+    for(size_t i = 0; i < numberOfIndexes; i++)
+    {
+        auto gridIndex = indexes[i];
+        auto codedIndex = codedIndexes[gridIndex];
+        values[gridIndex] = codedIndex < 0 || codedIndex >= numberOfCodedValues ? missingValue : unpackedValues[codedIndex];
+    }
+
+    return true;
+}
\ No newline at end of file
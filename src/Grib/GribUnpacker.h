@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+//Native decode of a GRIB2 message's data section for the packings NOAA uses on HRRR and GFS: simple packing (5.0) and complex packing,
+//with or without spatial differencing (5.2, 5.3). Anything else (JPEG2000 5.40, PNG 5.41, a reused bitmap, more than one field in a message)
+//returns false so the caller can let eccodes have it.
+//
+//Only the grid points in indexes are written to values, which is indexed the same as eccodes' values array. Simple packing is read
+//straight out of the bit stream at each index. Complex packing can't be jumped into, so it's decoded in full and then picked from.
+//Missing points, by bitmap or by missing value management, come out as missingValue, the same as eccodes.
+bool UnpackGribValues(const uint8_t* message, size_t messageLength, const int32_t* indexes, size_t numberOfIndexes, double missingValue, double* values);
\ No newline at end of file
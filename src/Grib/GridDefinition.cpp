@@ -0,0 +1,185 @@
+#include "GridDefinition.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+static const double degreesToRadians = M_PI / 180.0;
+static const double radiansToDegrees = 180.0 / M_PI;
+
+inline bool GetDouble(codes_handle* h, const char* key, double& value) { return codes_get_double(h, key, &value) == CODES_SUCCESS; }
+
+inline bool GetLong(codes_handle* h, const char* key, long& value) { return codes_get_long(h, key, &value) == CODES_SUCCESS; }
+
+inline double NormalizeLongitude(double lon)
+{
+    lon = fmod(lon, 360.0);
+    return lon < 0 ? lon + 360.0 : lon;
+}
+
+//Longitude relative to lonStart, in [-180, 180).
+inline double LongitudeDelta(double lon, double lonStart) { return NormalizeLongitude(lon - lonStart + 180.0) - 180.0; }
+
+inline double ConformalTan(double lat) { return tan(M_PI / 4.0 + lat / 2.0); }
+
+GridDefinition::GridDefinition(codes_handle* h)
+{
+    char gridTypeName[64] = {0};
+    size_t length = sizeof(gridTypeName);
+    long iScansNegatively = 0, jScansPositively = 0, jPointsAreConsecutive = 0, alternativeRowScanning = 0, earthIsOblate = 0, nx = 0, ny = 0;
+
+    if(codes_get_string(h, "gridType", gridTypeName, &length) != CODES_SUCCESS)
+        return;
+
+    //Anything but plain WE rows, one after the other, goes back to iterating.
+    GetLong(h, "iScansNegatively", iScansNegatively);
+    GetLong(h, "jScansPositively", jScansPositively);
+    GetLong(h, "jPointsAreConsecutive", jPointsAreConsecutive);
+    GetLong(h, "alternativeRowScanning", alternativeRowScanning);
+    if(iScansNegatively || jPointsAreConsecutive || alternativeRowScanning)
+        return;
+
+    rowsScanNorthward = jScansPositively != 0;
+
+    if(!strcmp(gridTypeName, "regular_ll"))
+    {
+        if(!GetLong(h, "Ni", nx) || !GetLong(h, "Nj", ny)
+            || !GetDouble(h, "latitudeOfFirstGridPointInDegrees", firstLat)
+            || !GetDouble(h, "longitudeOfFirstGridPointInDegrees", firstLon)
+            || !GetDouble(h, "iDirectionIncrementInDegrees", lonIncrement)
+            || !GetDouble(h, "jDirectionIncrementInDegrees", latIncrement))
+            return;
+
+        firstLon = NormalizeLongitude(firstLon);
+        columns = static_cast<int32_t>(nx);
+        rows = static_cast<int32_t>(ny);
+        gridType = GridType::RegularLatLonGridType;
+    }
+    else if(!strcmp(gridTypeName, "lambert"))
+    {
+        double latin1 = 0, latin2 = 0, lov = 0;
+        GeoCoord firstPoint = {0};
+
+        GetLong(h, "earthIsOblate", earthIsOblate);
+        if(earthIsOblate)
+            return;
+
+        if(!GetLong(h, "Nx", nx) || !GetLong(h, "Ny", ny)
+            || !GetDouble(h, "latitudeOfFirstGridPointInDegrees", firstPoint.lat)
+            || !GetDouble(h, "longitudeOfFirstGridPointInDegrees", firstPoint.lon)
+            || !GetDouble(h, "LoVInDegrees", lov)
+            || !GetDouble(h, "Latin1InDegrees", latin1)
+            || !GetDouble(h, "Latin2InDegrees", latin2)
+            || !GetDouble(h, "DxInMetres", dx)
+            || !GetDouble(h, "DyInMetres", dy)
+            || !GetDouble(h, "radius", radius))
+            return;
+
+        latin1 *= degreesToRadians;
+        latin2 *= degreesToRadians;
+        centralMeridian = NormalizeLongitude(lov);
+
+        if(fabs(latin1 - latin2) < 1e-10)
+            n = sin(latin1);
+        else
+            n = log(cos(latin1) / cos(latin2)) / log(ConformalTan(latin2) / ConformalTan(latin1));
+
+        f = cos(latin1) * pow(ConformalTan(latin1), n) / n;
+
+        columns = static_cast<int32_t>(nx);
+        rows = static_cast<int32_t>(ny);
+        gridType = GridType::LambertConformalGridType;
+
+        LambertToXY(firstPoint, firstX, firstY);
+    }
+}
+
+void GridDefinition::LambertToXY(const GeoCoord& coord, double& x, double& y) const
+{
+    auto rho = radius * f / pow(ConformalTan(coord.lat * degreesToRadians), n);
+    auto theta = n * LongitudeDelta(coord.lon, centralMeridian) * degreesToRadians;
+
+    x = rho * sin(theta);
+    y = -rho * cos(theta);
+}
+
+GeoCoord GridDefinition::ToGeoCoord(int32_t column, int32_t row) const
+{
+    auto northwardRow = rowsScanNorthward ? row : -row;
+
+    if(gridType == GridType::RegularLatLonGridType)
+        return { firstLat + northwardRow * latIncrement, NormalizeLongitude(firstLon + column * lonIncrement) };
+
+    auto x = firstX + column * dx;
+    auto y = firstY + northwardRow * dy;
+    auto sign = n < 0 ? -1.0 : 1.0;
+    auto rho = sign * sqrt(x * x + y * y);
+    auto theta = atan2(sign * x, -sign * y);
+
+    GeoCoord coord = {0};
+    coord.lat = rho == 0 ? sign * 90.0 : (2.0 * atan(pow(radius * f / rho, 1.0 / n)) - M_PI / 2.0) * radiansToDegrees;
+    coord.lon = NormalizeLongitude(centralMeridian + (theta / n) * radiansToDegrees);
+    return coord;
+}
+
+void GridDefinition::ToGridPoint(const GeoCoord& coord, double& column, double& row) const
+{
+    auto rowDirection = rowsScanNorthward ? 1.0 : -1.0;
+
+    if(gridType == GridType::RegularLatLonGridType)
+    {
+        //Anything past the middle of the gap the grid doesn't cover counts as being to the west of it.
+        auto lonDelta = NormalizeLongitude(coord.lon - firstLon);
+        if(lonDelta > (columns * lonIncrement + 360.0) / 2.0)
+            lonDelta -= 360.0;
+
+        column = lonDelta / lonIncrement;
+        row = rowDirection * (coord.lat - firstLat) / latIncrement;
+        return;
+    }
+
+    double x = 0, y = 0;
+    LambertToXY(coord, x, y);
+    column = (x - firstX) / dx;
+    row = rowDirection * (y - firstY) / dy;
+}
+
+bool GridDefinition::GetCellRangeForBounds(const GeoBounds& geoBounds, int32_t& firstColumn, int32_t& lastColumn, int32_t& firstRow, int32_t& lastRow) const
+{
+    //Lat/lon boxes come out curved on a Lambert grid, but since the projection has no folds the extremes are always on the edges,
+    //so walking the edges finely enough finds them. A cell of padding covers anything between the samples.
+    const int32_t samplesPerEdge = 256;
+    double minColumn = INFINITY, maxColumn = -INFINITY, minRow = INFINITY, maxRow = -INFINITY;
+
+    auto latSpan = geoBounds.topLat - geoBounds.bottomLat;
+    auto lonSpan = geoBounds.rightLon - geoBounds.leftLon;
+    for(auto i = 0; i <= samplesPerEdge; i++)
+    {
+        auto t = i / static_cast<double>(samplesPerEdge);
+        GeoCoord samples[4] = {
+            { geoBounds.bottomLat + t * latSpan, geoBounds.leftLon },
+            { geoBounds.bottomLat + t * latSpan, geoBounds.rightLon },
+            { geoBounds.topLat, geoBounds.leftLon + t * lonSpan },
+            { geoBounds.bottomLat, geoBounds.leftLon + t * lonSpan }
+        };
+
+        for(auto& sample : samples)
+        {
+            double column = 0, row = 0;
+            ToGridPoint(sample, column, row);
+            minColumn = min(minColumn, column);
+            maxColumn = max(maxColumn, column);
+            minRow = min(minRow, row);
+            maxRow = max(maxRow, row);
+        }
+    }
+
+    firstColumn = max(0, static_cast<int32_t>(floor(minColumn)) - 1);
+    lastColumn = min(columns - 1, static_cast<int32_t>(ceil(maxColumn)) + 1);
+    firstRow = max(0, static_cast<int32_t>(floor(minRow)) - 1);
+    lastRow = min(rows - 1, static_cast<int32_t>(ceil(maxRow)) + 1);
+
+    return firstColumn <= lastColumn && firstRow <= lastRow;
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Data/SelectedRegion.h"
+
+#include <eccodes.h>
+#include <stdint.h>
+
+enum GridType { UnsupportedGridType, LambertConformalGridType, RegularLatLonGridType };
+
+//An inclusive block of columns and rows.
+struct GridCellRange
+{
+    int32_t firstColumn, lastColumn, firstRow, lastRow;
+
+    inline bool Contains(int32_t column, int32_t row) const { return column >= firstColumn && column <= lastColumn && row >= firstRow && row <= lastRow; }
+    inline GridCellRange Grow(int32_t cells) const { return { firstColumn - cells, lastColumn + cells, firstRow - cells, lastRow + cells }; }
+};
+
+//Just enough of a GRIB grid definition section to go between grid columns/rows and lat/lon without iterating every point in the grid.
+//Columns and rows are in the GRIB's own storage order, so index = row * columns + column lines up with the values array.
+class GridDefinition
+{
+private:
+    GridType gridType = GridType::UnsupportedGridType;
+    int32_t columns = 0, rows = 0;
+    bool rowsScanNorthward = true;
+
+    //Regular lat/lon.
+    double firstLat = 0, firstLon = 0, latIncrement = 0, lonIncrement = 0;
+
+    //Lambert conformal on a sphere, per Snyder's Map Projections: A Working Manual (USGS PP 1395), p. 104-107.
+    double radius = 0, centralMeridian = 0, n = 0, f = 0, firstX = 0, firstY = 0, dx = 0, dy = 0;
+
+    void LambertToXY(const GeoCoord& coord, double& x, double& y) const;
+
+public:
+    GridDefinition() = default;
+    GridDefinition(codes_handle* h);
+
+    inline GridType GetGridType() const { return gridType; }
+    inline bool IsSupported() const { return gridType != GridType::UnsupportedGridType; }
+    inline int32_t GetColumns() const { return columns; }
+    inline int32_t GetRows() const { return rows; }
+    inline bool RowsScanNorthward() const { return rowsScanNorthward; }
+    inline int32_t ToIndex(int32_t column, int32_t row) const { return row * columns + column; }
+
+    //The row one step south of row, which may be off the grid.
+    inline int32_t RowToTheSouth(int32_t row) const { return rowsScanNorthward ? row - 1 : row + 1; }
+
+    GeoCoord ToGeoCoord(int32_t column, int32_t row) const;
+
+    //Fractional, and can land outside of the grid. Callers decide how to round.
+    void ToGridPoint(const GeoCoord& coord, double& column, double& row) const;
+
+    //The smallest block of columns and rows, clamped to the grid, that covers geoBounds. False if geoBounds misses the grid entirely.
+    bool GetCellRangeForBounds(const GeoBounds& geoBounds, int32_t& firstColumn, int32_t& lastColumn, int32_t& firstRow, int32_t& lastRow) const;
+};
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "GridGeometryCache.h"
+#include "Error.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static const char gridGeometryMagic[4] = {'L', 'F', 'G', 'G'};
+static const uint32_t gridGeometryVersion = 1;
+
+//Fixed size, and a multiple of 8, so the GeoCoords right after it are aligned in the mapping.
+struct GridGeometryHeader {
+    char magic[4];
+    uint32_t version;
+    char gridHash[40];
+    GeoBounds geoBounds;
+    uint64_t numberOfPoints, numberOfQuads;
+};
+
+static_assert(sizeof(GridGeometryHeader) % alignof(GeoCoord) == 0);
+
+//FNV-1a, so the same bounds name the same file from one build to the next.
+inline uint64_t HashGeoBounds(const GeoBounds& geoBounds)
+{
+    uint64_t hash = 14695981039346656037ull;
+    auto bytes = reinterpret_cast<const uint8_t*>(&geoBounds);
+    for(size_t i = 0; i < sizeof(GeoBounds); i++)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+
+    return hash;
+}
+
+inline size_t GetExpectedLength(uint64_t numberOfPoints, uint64_t numberOfQuads)
+{
+    return sizeof(GridGeometryHeader) + numberOfPoints * (sizeof(GeoCoord) + sizeof(int32_t)) + numberOfQuads * sizeof(QuadIndexes);
+}
+
+fs::path GetGridGeometryCachePath(const fs::path& directory, const string& gridHash, const GeoBounds& geoBounds)
+{
+    char fileName[128] = {0};
+    snprintf(fileName, sizeof(fileName), "geometry-%s-%016llx.bin", gridHash.c_str(), static_cast<unsigned long long>(HashGeoBounds(geoBounds)));
+    return directory / fileName;
+}
+
+void RemoveStaleGridGeometry(const fs::path& directory, const string& gridHash)
+{
+    error_code ec;
+    auto current = "geometry-" + gridHash + "-";
+    for(auto& entry : fs::directory_iterator(directory, ec))
+    {
+        auto fileName = entry.path().filename().string();
+        if(fileName.starts_with("geometry-") && !fileName.starts_with(current))
+            fs::remove(entry.path(), ec);
+    }
+}
+
+void SaveGridGeometry(const fs::path& path, const string& gridHash, const GeoBounds& geoBounds, const vector<int32_t>& validIndexes,
+    const unordered_map<int32_t, GeoCoord>& geoCoords, const vector<QuadIndexes>& quads)
+{
+    GridGeometryHeader header = {};
+    memcpy(header.magic, gridGeometryMagic, sizeof(gridGeometryMagic));
+    header.version = gridGeometryVersion;
+    strncpy(header.gridHash, gridHash.c_str(), sizeof(header.gridHash) - 1);
+    header.geoBounds = geoBounds;
+    header.numberOfPoints = validIndexes.size();
+    header.numberOfQuads = quads.size();
+
+    vector<GeoCoord> coords;
+    coords.reserve(validIndexes.size());
+    for(auto& index : validIndexes)
+        coords.push_back(geoCoords.at(index));
+
+    //Written to the side and renamed in, so a run that dies halfway never leaves a file that looks usable.
+    auto tempPath = fs::path(path).concat(".tmp");
+    auto f = fopen(tempPath.c_str(), "wb");
+    if(!f)
+        ERR_OUT("Unable to open " << tempPath);
+
+    fwrite(&header, sizeof(GridGeometryHeader), 1, f);
+    fwrite(coords.data(), sizeof(GeoCoord), coords.size(), f);
+    fwrite(validIndexes.data(), sizeof(int32_t), validIndexes.size(), f);
+    fwrite(quads.data(), sizeof(QuadIndexes), quads.size(), f);
+    fclose(f);
+
+    error_code ec;
+    fs::rename(tempPath, path, ec);
+    if(ec)
+        fs::remove(tempPath, ec);
+}
+
+MappedGridGeometry* MappedGridGeometry::Open(const fs::path& path, const string& gridHash, const GeoBounds& geoBounds)
+{
+    auto fd = open(path.c_str(), O_RDONLY);
+    if(fd == -1)
+        return nullptr;
+
+    struct stat fileStat = {};
+    if(fstat(fd, &fileStat) == -1 || fileStat.st_size < static_cast<off_t>(sizeof(GridGeometryHeader)))
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    auto length = static_cast<size_t>(fileStat.st_size);
+    auto mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED)
+        return nullptr;
+
+    auto result = new MappedGridGeometry();
+    result->mapping = mapping;
+    result->length = length;
+
+    auto header = static_cast<const GridGeometryHeader*>(mapping);
+    if(memcmp(header->magic, gridGeometryMagic, sizeof(gridGeometryMagic)) || header->version != gridGeometryVersion
+        || strncmp(header->gridHash, gridHash.c_str(), sizeof(header->gridHash)) || memcmp(&header->geoBounds, &geoBounds, sizeof(GeoBounds))
+        || GetExpectedLength(header->numberOfPoints, header->numberOfQuads) != length)
+    {
+        delete result;
+        return nullptr;
+    }
+
+    madvise(mapping, length, MADV_SEQUENTIAL);
+
+    auto bytes = static_cast<const uint8_t*>(mapping) + sizeof(GridGeometryHeader);
+    result->numberOfPoints = header->numberOfPoints;
+    result->numberOfQuads = header->numberOfQuads;
+    result->geoCoords = reinterpret_cast<const GeoCoord*>(bytes);
+    result->validIndexes = reinterpret_cast<const int32_t*>(bytes + result->numberOfPoints * sizeof(GeoCoord));
+    result->quads = reinterpret_cast<const QuadIndexes*>(bytes + result->numberOfPoints * (sizeof(GeoCoord) + sizeof(int32_t)));
+    return result;
+}
+
+MappedGridGeometry::~MappedGridGeometry()
+{
+    if(mapping)
+        munmap(mapping, length);
+}
\ No newline at end of file
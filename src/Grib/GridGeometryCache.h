@@ -0,0 +1,47 @@
+#pragma once
+
+#include "GribData.h"
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//The in bounds points and quads only depend on the grid and the region, so they're kept on disk between runs.
+//The file name carries both, so a new grid from NOAA, or a new region, just misses and gets built fresh.
+std::filesystem::path GetGridGeometryCachePath(const std::filesystem::path& directory, const std::string& gridHash, const GeoBounds& geoBounds);
+
+//Removes every cached geometry in directory that was built from some other grid.
+void RemoveStaleGridGeometry(const std::filesystem::path& directory, const std::string& gridHash);
+
+void SaveGridGeometry(const std::filesystem::path& path, const std::string& gridHash, const GeoBounds& geoBounds, const std::vector<int32_t>& validIndexes,
+    const std::unordered_map<int32_t, GeoCoord>& geoCoords, const std::vector<QuadIndexes>& quads);
+
+//Read only view of a cached geometry file, straight out of the page cache.
+class MappedGridGeometry
+{
+private:
+    void* mapping = nullptr;
+    size_t length = 0;
+    size_t numberOfPoints = 0, numberOfQuads = 0;
+    const GeoCoord* geoCoords = nullptr;
+    const int32_t* validIndexes = nullptr;
+    const QuadIndexes* quads = nullptr;
+
+    MappedGridGeometry() = default;
+
+public:
+    MappedGridGeometry(const MappedGridGeometry&) = delete;
+    MappedGridGeometry& operator=(const MappedGridGeometry&) = delete;
+    ~MappedGridGeometry();
+
+    //nullptr when there's no file, or it doesn't match the grid and region it's being asked for.
+    static MappedGridGeometry* Open(const std::filesystem::path& path, const std::string& gridHash, const GeoBounds& geoBounds);
+
+    inline size_t GetNumberOfPoints() const { return numberOfPoints; }
+    inline size_t GetNumberOfQuads() const { return numberOfQuads; }
+    //Parallel to GetValidIndexes.
+    inline const GeoCoord* GetGeoCoords() const { return geoCoords; }
+    inline const int32_t* GetValidIndexes() const { return validIndexes; }
+    inline const QuadIndexes* GetQuads() const { return quads; }
+};
\ No newline at end of file
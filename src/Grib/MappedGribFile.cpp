@@ -0,0 +1,86 @@
+#include "MappedGribFile.h"
+#include "Error.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+inline uint64_t ReadBigEndian(const uint8_t* bytes, int32_t count)
+{
+    uint64_t value = 0;
+    for(auto i = 0; i < count; i++)
+        value = (value << 8) | bytes[i];
+
+    return value;
+}
+
+MappedGribFile::MappedGribFile(const string& fileName) : fileName(fileName)
+{
+    auto fd = open(fileName.c_str(), O_RDONLY);
+    if(fd == -1)
+        ERR_OUT(fileName << " not found.");
+
+    struct stat fileStat = {};
+    if(fstat(fd, &fileStat) == -1)
+        ERR_OUT("Unable to stat " << fileName);
+
+    length = static_cast<size_t>(fileStat.st_size);
+    if(length)
+    {
+        auto result = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(result == MAP_FAILED)
+            ERR_OUT("Unable to map " << fileName);
+
+        mapping = static_cast<const uint8_t*>(result);
+
+        //Read front to back exactly once, so read ahead as far as the kernel will and don't bother keeping pages around behind us.
+        madvise(result, length, MADV_SEQUENTIAL);
+        madvise(result, length, MADV_WILLNEED);
+    }
+
+    close(fd);
+}
+
+MappedGribFile::~MappedGribFile()
+{
+    if(!mapping)
+        return;
+
+    auto address = const_cast<uint8_t*>(mapping);
+    madvise(address, length, MADV_DONTNEED);
+    munmap(address, length);
+}
+
+bool NextGribMessage(const uint8_t* data, size_t length, size_t& offset, const void*& message, size_t& messageLength, const string& name)
+{
+    //Skip anything between messages, the same as eccodes does when reading from a FILE*.
+    while(offset + 16 <= length && memcmp(data + offset, "GRIB", 4))
+        offset++;
+
+    if(offset + 16 > length)
+        return false;
+
+    auto start = data + offset;
+    switch(start[7])
+    {
+        case 1:
+            messageLength = ReadBigEndian(start + 4, 3);
+            break;
+        case 2:
+            messageLength = ReadBigEndian(start + 8, 8);
+            break;
+        default:
+            ERR_OUT(name << ": unknown GRIB edition " << static_cast<int32_t>(start[7]) << " at byte " << offset);
+    }
+
+    if(messageLength < 16 || offset + messageLength > length || memcmp(start + messageLength - 4, "7777", 4))
+        ERR_OUT(name << ": truncated GRIB message at byte " << offset);
+
+    message = start;
+    offset += messageLength;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+//Finds the next message in data starting from offset, and moves offset past it. False once there are no more messages.
+//Only looks at section 0 and the 7777 at the end, so it works on anything holding whole messages back to back.
+bool NextGribMessage(const uint8_t* data, size_t length, size_t& offset, const void*& message, size_t& messageLength, const std::string& name);
+
+//A GRIB file mapped straight into memory, walked one message at a time.
+//Each message is only a pointer into the mapping, so it has to be done with before the MappedGribFile goes away.
+class MappedGribFile
+{
+private:
+    const uint8_t* mapping = nullptr;
+    size_t length = 0, offset = 0;
+    std::string fileName;
+
+public:
+    MappedGribFile(const std::string& fileName);
+    MappedGribFile(const MappedGribFile&) = delete;
+    MappedGribFile& operator=(const MappedGribFile&) = delete;
+    ~MappedGribFile();
+
+    inline bool NextMessage(const void*& message, size_t& messageLength) { return NextGribMessage(mapping, length, offset, message, messageLength, fileName); }
+};
\ No newline at end of file
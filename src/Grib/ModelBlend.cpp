@@ -0,0 +1,140 @@
+#include "Calcs.h"
+#include "ModelBlend.h"
+
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+
+using namespace std;
+
+double GetLaterModelWeight(int32_t hour, uint16_t fadeStartHour, uint16_t fadeEndHour)
+{
+    if(hour >= fadeEndHour)
+        return 1;
+
+    if(hour <= fadeStartHour)
+        return 0;
+
+    return static_cast<double>(hour - fadeStartHour) / (fadeEndHour - fadeStartHour);
+}
+
+//GFS doesn't have 10si, but the forecasts read wind speed off the column, so it's made from u and v where it's missing.
+inline bool HasField(const RawForecastHour* hour, GribField field)
+{
+    if(!hour)
+        return false;
+
+    if(!hour->fields[field].empty())
+        return true;
+
+    return field == GribField::WindSpeedField && !hour->fields[GribField::WindUField].empty() && !hour->fields[GribField::WindVField].empty();
+}
+
+inline double FieldAt(const RawForecastHour& hour, GribField field, size_t point)
+{
+    auto& column = hour.fields[field];
+    if(!column.empty())
+        return column[point];
+
+    auto u = hour.fields[GribField::WindUField][point], v = hour.fields[GribField::WindVField][point];
+    return ToMPH(sqrt(u * u + v * v));
+}
+
+//How much field went up since previous, or all of it when there's nothing before it to go on.
+inline double RiseAt(const RawForecastHour& hour, const RawForecastHour* previous, GribField field, size_t point)
+{
+    auto value = hour.fields[field][point];
+    return HasField(previous, field) ? max(0.0, value - previous->fields[field][point]) : value;
+}
+
+//The weight for field, moved all the way to whichever side has it when only one does.
+inline double FieldWeight(bool earlierHas, bool laterHas, double laterWeight) { return !earlierHas ? 1 : !laterHas ? 0 : laterWeight; }
+
+static void BlendTotal(const BlendedHourSources& sources, const RawForecastHour* blendedPrevious, GribField field, size_t numberOfPoints, RawForecastHour& blended)
+{
+    //A rise is only worth anything from a side that has the hour before too, unless it's the very first hour, where the whole total is the rise.
+    auto earlierHas = HasField(sources.earlier, field) && (!blendedPrevious || HasField(sources.earlierPrevious, field));
+    auto laterHas = HasField(sources.later, field) && (!blendedPrevious || HasField(sources.laterPrevious, field));
+    auto carried = HasField(blendedPrevious, field);
+    if(!earlierHas && !laterHas && !carried)
+        return;
+
+    auto& total = blended.fields[field];
+    auto isPrecipitation = field == GribField::TotalPrecipitationField;
+    auto& newPrecipitation = blended.fields[GribField::NewPrecipitationField];
+    if(isPrecipitation)
+        newPrecipitation.resize(numberOfPoints, 0);
+
+    //Nothing to say how much it rose, so it holds where it was.
+    if(!earlierHas && !laterHas)
+    {
+        total = blendedPrevious->fields[field];
+        return;
+    }
+
+    auto weight = FieldWeight(earlierHas, laterHas, sources.laterWeight);
+    total.resize(numberOfPoints);
+
+    #pragma omp parallel for
+    for(size_t point = 0; point < numberOfPoints; point++)
+    {
+        auto rise = 0.0;
+        if(weight < 1)
+            rise += (1 - weight) * RiseAt(*sources.earlier, sources.earlierPrevious, field, point);
+
+        if(weight > 0)
+            rise += weight * RiseAt(*sources.later, sources.laterPrevious, field, point);
+
+        total[point] = (carried ? blendedPrevious->fields[field][point] : 0) + rise;
+        if(isPrecipitation)
+            newPrecipitation[point] = rise;
+    }
+}
+
+void BlendHour(const BlendedHourSources& sources, const RawForecastHour* blendedPrevious, size_t numberOfPoints, RawForecastHour& blended)
+{
+    blended = {};
+
+    auto weight = FieldWeight(sources.earlier, sources.later, sources.laterWeight);
+    auto nearer = weight < 0.5 ? sources.earlier : sources.later;
+    blended.precipitationTypes = nearer->precipitationTypes;
+    copy(begin(nearer->stepStarts), end(nearer->stepStarts), begin(blended.stepStarts));
+
+    for(auto f = 0; f < GribFieldCount; f++)
+    {
+        auto field = static_cast<GribField>(f);
+        switch(field)
+        {
+            case GribField::TotalPrecipitationField:
+            case GribField::TotalSnowField:
+                BlendTotal(sources, blendedPrevious, field, numberOfPoints, blended);
+                continue;
+            case GribField::NewPrecipitationField:
+            case GribField::PrecipitationBucketField:
+                continue;
+            default:
+                break;
+        }
+
+        auto earlierHas = HasField(sources.earlier, field), laterHas = HasField(sources.later, field);
+        if(IsCategoricalGribField(field) || (!earlierHas && !laterHas))
+            continue;
+
+        auto fieldWeight = FieldWeight(earlierHas, laterHas, weight);
+        auto& column = blended.fields[field];
+        column.resize(numberOfPoints);
+
+        #pragma omp parallel for
+        for(size_t point = 0; point < numberOfPoints; point++)
+        {
+            auto value = 0.0;
+            if(fieldWeight < 1)
+                value += (1 - fieldWeight) * FieldAt(*sources.earlier, field, point);
+
+            if(fieldWeight > 0)
+                value += fieldWeight * FieldAt(*sources.later, field, point);
+
+            column[point] = value;
+        }
+    }
+}
\ No newline at end of file
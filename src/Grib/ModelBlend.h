@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Grib.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+//Where one hour of a blend of two models comes from, both on the same points. Either side can be missing the hour,
+//and each previous hour is that model's own last one before it, for the totals to be carried on from.
+struct BlendedHourSources
+{
+    const RawForecastHour* earlier = nullptr, *earlierPrevious = nullptr, *later = nullptr, *laterPrevious = nullptr;
+    //0 is all the earlier model, 1 all the later.
+    double laterWeight = 0;
+};
+
+//All the earlier model through fadeStartHour, all the later one from fadeEndHour on, and a straight line in between.
+double GetLaterModelWeight(int32_t hour, uint16_t fadeStartHour, uint16_t fadeEndHour);
+
+//Blends each field by weight, falling back on whichever side has it. Totals aren't blended outright, since two models' totals can be far apart,
+//and the fade would have them jump or even drop. Instead, blendedPrevious (null for the first hour) is carried on by a blend of how much each
+//model's rose since its own previous hour, which is also the new precipitation.
+void BlendHour(const BlendedHourSources& sources, const RawForecastHour* blendedPrevious, size_t numberOfPoints, RawForecastHour& blended);
\ No newline at end of file
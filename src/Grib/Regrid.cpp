@@ -0,0 +1,112 @@
+#include "Error.h"
+#include "Regrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+
+using namespace std;
+
+vector<RegridStencil> BuildRegridStencils(const GridDefinition& grid, const vector<int32_t>& sourceIndexes, const vector<GeoCoord>& points)
+{
+    if(!grid.IsSupported())
+        ERR_OUT("Regridding needs a grid that GridDefinition can work with.");
+
+    //Grid index to position in the source's columns, dense, since the lookups are random and there are four per point.
+    vector<int32_t> positions(static_cast<size_t>(grid.GetColumns()) * grid.GetRows(), -1);
+    for(size_t position = 0; position < sourceIndexes.size(); position++)
+        positions[sourceIndexes[position]] = static_cast<int32_t>(position);
+
+    vector<RegridStencil> stencils(points.size());
+    vector<uint8_t> uncovered(points.size(), false);
+
+    #pragma omp parallel for
+    for(size_t point = 0; point < points.size(); point++)
+    {
+        double column = 0, row = 0;
+        grid.ToGridPoint(points[point], column, row);
+
+        auto left = static_cast<int32_t>(floor(column)), bottom = static_cast<int32_t>(floor(row));
+        auto x = column - left, y = row - bottom;
+        int32_t cornerColumns[4] = { left, left + 1, left, left + 1 };
+        int32_t cornerRows[4] = { bottom, bottom, bottom + 1, bottom + 1 };
+        double cornerWeights[4] = { (1 - x) * (1 - y), x * (1 - y), (1 - x) * y, x * y };
+
+        auto& stencil = stencils[point];
+        auto totalWeight = 0.0;
+        for(auto corner = 0; corner < 4; corner++)
+        {
+            stencil.positions[corner] = 0;
+            stencil.weights[corner] = 0;
+
+            if(cornerColumns[corner] < 0 || cornerColumns[corner] >= grid.GetColumns() || cornerRows[corner] < 0 || cornerRows[corner] >= grid.GetRows())
+                continue;
+
+            auto position = positions[grid.ToIndex(cornerColumns[corner], cornerRows[corner])];
+            if(position < 0)
+                continue;
+
+            stencil.positions[corner] = position;
+            stencil.weights[corner] = static_cast<float>(cornerWeights[corner]);
+            totalWeight += cornerWeights[corner];
+        }
+
+        if(totalWeight <= 0)
+        {
+            uncovered[point] = true;
+            continue;
+        }
+
+        for(auto corner = 0; corner < 4; corner++)
+            stencil.weights[corner] = static_cast<float>(stencil.weights[corner] / totalWeight);
+    }
+
+    auto firstUncovered = find(uncovered.begin(), uncovered.end(), true);
+    if(firstUncovered != uncovered.end())
+    {
+        auto& coord = points[firstUncovered - uncovered.begin()];
+        ERR_OUT("Nothing to regrid from around " << coord.lat << ", " << coord.lon << ".");
+    }
+
+    return stencils;
+}
+
+void RegridHour(const RawForecastHour& source, const vector<RegridStencil>& stencils, RawForecastHour& target)
+{
+    target = {};
+    copy(begin(source.stepStarts), end(source.stepStarts), begin(target.stepStarts));
+
+    for(auto field = 0; field < GribFieldCount; field++)
+    {
+        auto& from = source.fields[field];
+        if(from.empty())
+            continue;
+
+        auto& to = target.fields[field];
+        to.resize(stencils.size());
+
+        #pragma omp parallel for
+        for(size_t point = 0; point < stencils.size(); point++)
+        {
+            auto& stencil = stencils[point];
+            auto value = 0.0;
+            for(auto corner = 0; corner < 4; corner++)
+                value += from[stencil.positions[corner]] * stencil.weights[corner];
+
+            to[point] = value;
+        }
+    }
+
+    if(source.precipitationTypes.empty())
+        return;
+
+    target.precipitationTypes.resize(stencils.size());
+
+    #pragma omp parallel for
+    for(size_t point = 0; point < stencils.size(); point++)
+    {
+        auto& stencil = stencils[point];
+        auto heaviest = max_element(begin(stencil.weights), end(stencil.weights)) - begin(stencil.weights);
+        target.precipitationTypes[point] = source.precipitationTypes[stencil.positions[heaviest]];
+    }
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Grib.h"
+#include "GridDefinition.h"
+
+#include <stdint.h>
+#include <vector>
+
+//The four source points around one target point, and how much each counts. A corner the source doesn't have gets no weight.
+struct RegridStencil
+{
+    int32_t positions[4];
+    float weights[4];
+};
+
+//Bilinear stencils for every one of points, off grid. sourceIndexes are the source's validIndexes, which have to be indexes into grid.
+//Built once, and shared by every hour regridded onto points.
+std::vector<RegridStencil> BuildRegridStencils(const GridDefinition& grid, const std::vector<int32_t>& sourceIndexes, const std::vector<GeoCoord>& points);
+
+//Every column source has, onto the stencils' points. Precipitation types come from whichever corner weighs the most.
+void RegridHour(const RawForecastHour& source, const std::vector<RegridStencil>& stencils, RawForecastHour& target);
\ No newline at end of file
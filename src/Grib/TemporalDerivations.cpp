@@ -0,0 +1,280 @@
+#include "TemporalDerivations.h"
+#include "Error.h"
+
+#include <algorithm>
+#include <omp.h>
+
+using namespace std;
+
+//Small enough that a block of every column a derivation touches stays in L2 while it's walked across the hours.
+static const size_t pointsPerBlock = 4096;
+
+//HRRR has snowfall (asnow) of its own, GFS only has depth. tp comes as a 0-N total plus a shorter bucket (1 hour on HRRR, up to 6 on GFS),
+//and the first hour's is only ever the total, so new precipitation is taken off the totals instead of trusting the bucket.
+static const vector<TemporalDerivation> hrrrDerivations = {
+    { GribField::TotalSnowField, GribField::TotalSnowField, TemporalScan::MonotonicScan },
+    { GribField::TotalPrecipitationField, GribField::TotalPrecipitationField, TemporalScan::MonotonicScan },
+    { GribField::TotalPrecipitationField, GribField::NewPrecipitationField, TemporalScan::BucketDifferenceScan }
+};
+
+static const vector<TemporalDerivation> gfsDerivations = {
+    { GribField::SnowDepthField, GribField::TotalSnowField, TemporalScan::AccumulatedIncreaseScan },
+    { GribField::TotalPrecipitationField, GribField::TotalPrecipitationField, TemporalScan::MonotonicScan },
+    { GribField::TotalPrecipitationField, GribField::NewPrecipitationField, TemporalScan::BucketDifferenceScan }
+};
+
+//GEFS only has tp in buckets (0-3, 0-6, 6-9...), so new precipitation comes off the buckets, and the total is built back up out of that.
+static const vector<TemporalDerivation> gefsDerivations = {
+    { GribField::SnowDepthField, GribField::TotalSnowField, TemporalScan::AccumulatedIncreaseScan },
+    { GribField::PrecipitationBucketField, GribField::NewPrecipitationField, TemporalScan::BucketDifferenceScan },
+    { GribField::NewPrecipitationField, GribField::TotalPrecipitationField, TemporalScan::RunningSumScan }
+};
+
+//HRRR's sub-hourly files have every tp in 15 minute buckets, the first ("0-15") included, so it goes the same way as GEFS.
+//asnow is bucketed the same way, so it's turned into what fell each step in place, then added back up. Should a step's asnow
+//start where the one before it did, the bucket difference takes it as a total, so this comes out right either way.
+static const vector<TemporalDerivation> hrrrSubHourlyDerivations = {
+    { GribField::TotalSnowField, GribField::TotalSnowField, TemporalScan::BucketDifferenceScan },
+    { GribField::TotalSnowField, GribField::TotalSnowField, TemporalScan::RunningSumScan },
+    { GribField::PrecipitationBucketField, GribField::NewPrecipitationField, TemporalScan::BucketDifferenceScan },
+    { GribField::NewPrecipitationField, GribField::TotalPrecipitationField, TemporalScan::RunningSumScan }
+};
+
+static const vector<TemporalDerivation> noDerivations;
+
+const vector<TemporalDerivation>& GetTemporalDerivations(WeatherModel weatherModel, bool subHourly)
+{
+    switch(weatherModel)
+    {
+        case WeatherModel::HRRR:
+            return subHourly ? hrrrSubHourlyDerivations : hrrrDerivations;
+        case WeatherModel::GFS:
+            return gfsDerivations;
+        case WeatherModel::GEFS:
+            return gefsDerivations;
+        default:
+            return noDerivations;
+    }
+}
+
+TemporalInterpolation GetTemporalInterpolation(GribField field)
+{
+    switch(field)
+    {
+        case GribField::NewPrecipitationField:
+            return TemporalInterpolation::DerivedInterpolation;
+        case GribField::PrecipitationBucketField:
+            return TemporalInterpolation::BucketInterpolation;
+        default:
+            return TemporalInterpolation::LinearInterpolation;
+    }
+}
+
+inline double ValueAt(const vector<double>& column, size_t point) { return column.empty() ? 0 : column[point]; }
+
+//Which hours the scan writes to. Every column that gets written is grown here, before any thread starts, so the scan itself never allocates.
+//Hours before the first one with anything to go on are left as they were read. If that first hour doesn't have a bucket difference
+//or running sum of its own, it gets the source, which is everything there is to go on so far.
+static vector<uint8_t> PrepareTargetColumns(const TemporalDerivation& derivation, vector<RawForecastHour>& hours, size_t numberOfPoints, size_t& firstHour)
+{
+    vector<uint8_t> scanned(hours.size(), false);
+    auto startsFrom = derivation.scan == TemporalScan::MonotonicScan ? derivation.target : derivation.source;
+    auto seedsTarget = derivation.scan == TemporalScan::BucketDifferenceScan || derivation.scan == TemporalScan::RunningSumScan;
+
+    firstHour = hours.size();
+    for(size_t hour = 0; hour < hours.size(); hour++)
+    {
+        if(firstHour == hours.size())
+        {
+            if(!hours[hour].fields[startsFrom].empty())
+            {
+                firstHour = hour;
+                if(seedsTarget && hours[hour].fields[derivation.target].empty())
+                    hours[hour].fields[derivation.target] = hours[hour].fields[derivation.source];
+            }
+
+            continue;
+        }
+
+        //A bucket can only be differenced against the hour right before it.
+        if(derivation.scan == TemporalScan::BucketDifferenceScan && (hours[hour].fields[derivation.source].empty() || hours[hour - 1].fields[derivation.source].empty()))
+            continue;
+
+        auto& target = hours[hour].fields[derivation.target];
+        if(target.empty())
+            target.resize(numberOfPoints, 0);
+
+        scanned[hour] = true;
+    }
+
+    return scanned;
+}
+
+static void ScanBlock(const TemporalDerivation& derivation, vector<RawForecastHour>& hours, const vector<uint8_t>& scanned, size_t firstHour, size_t begin, size_t end, vector<double>& state)
+{
+    auto& first = hours[firstHour];
+    switch(derivation.scan)
+    {
+        case TemporalScan::AccumulatedIncreaseScan:
+        {
+            //Last known source value, so an hour that's missing it doesn't count as a drop to zero and then a rise back.
+            for(auto i = begin; i < end; i++)
+                state[i - begin] = first.fields[derivation.source][i];
+
+            for(auto hour = firstHour + 1; hour < hours.size(); hour++)
+            {
+                auto& source = hours[hour].fields[derivation.source];
+                auto& target = hours[hour].fields[derivation.target];
+                auto& previousTarget = hours[hour - 1].fields[derivation.target];
+                for(auto i = begin; i < end; i++)
+                {
+                    auto increase = 0.0;
+                    if(!source.empty())
+                    {
+                        increase = max(0.0, source[i] - state[i - begin]);
+                        state[i - begin] = source[i];
+                    }
+
+                    target[i] = ValueAt(previousTarget, i) + increase;
+                }
+            }
+            break;
+        }
+        case TemporalScan::BucketDifferenceScan:
+        {
+            //The source as it was read, in case the target is the source.
+            for(auto i = begin; i < end; i++)
+                state[i - begin] = first.fields[derivation.source][i];
+
+            for(auto hour = firstHour + 1; hour < hours.size(); hour++)
+            {
+                auto& source = hours[hour].fields[derivation.source];
+                if(source.empty())
+                    continue;
+
+                auto& target = hours[hour].fields[derivation.target];
+                auto sameBucket = hours[hour].stepStarts[derivation.source] == hours[hour - 1].stepStarts[derivation.source];
+                for(auto i = begin; i < end; i++)
+                {
+                    auto value = source[i];
+                    if(scanned[hour])
+                        target[i] = sameBucket ? max(0.0, value - state[i - begin]) : value;
+
+                    state[i - begin] = value;
+                }
+            }
+            break;
+        }
+        case TemporalScan::MonotonicScan:
+        {
+            for(auto i = begin; i < end; i++)
+                state[i - begin] = first.fields[derivation.target][i];
+
+            for(auto hour = firstHour + 1; hour < hours.size(); hour++)
+            {
+                auto& target = hours[hour].fields[derivation.target];
+                for(auto i = begin; i < end; i++)
+                    target[i] = state[i - begin] = max(state[i - begin], target[i]);
+            }
+            break;
+        }
+        case TemporalScan::RunningSumScan:
+        {
+            for(auto i = begin; i < end; i++)
+                state[i - begin] = first.fields[derivation.target][i];
+
+            for(auto hour = firstHour + 1; hour < hours.size(); hour++)
+            {
+                auto& source = hours[hour].fields[derivation.source];
+                auto& target = hours[hour].fields[derivation.target];
+                for(auto i = begin; i < end; i++)
+                    target[i] = state[i - begin] += ValueAt(source, i);
+            }
+            break;
+        }
+    }
+}
+
+void DeriveTemporalFields(WeatherModel weatherModel, vector<RawForecastHour>& hours, size_t numberOfPoints, bool subHourly)
+{
+    auto& derivations = GetTemporalDerivations(weatherModel, subHourly);
+
+    vector<vector<uint8_t>> scanned(derivations.size());
+    vector<size_t> firstHours(derivations.size());
+    for(size_t d = 0; d < derivations.size(); d++)
+        scanned[d] = PrepareTargetColumns(derivations[d], hours, numberOfPoints, firstHours[d]);
+
+    #pragma omp parallel
+    {
+        vector<double> state(pointsPerBlock);
+
+        #pragma omp for schedule(static)
+        for(size_t begin = 0; begin < numberOfPoints; begin += pointsPerBlock)
+        {
+            auto end = min(begin + pointsPerBlock, numberOfPoints);
+            for(size_t d = 0; d < derivations.size(); d++)
+            {
+                if(firstHours[d] < hours.size())
+                    ScanBlock(derivations[d], hours, scanned[d], firstHours[d], begin, end, state);
+            }
+        }
+    }
+}
+
+void InterpolateHours(vector<RawForecastHour>& hours, const vector<uint16_t>& forecastHours, const vector<uint8_t>& interpolated, size_t numberOfPoints)
+{
+    size_t before = 0;
+    for(size_t hour = 0; hour < hours.size(); hour++)
+    {
+        if(!interpolated[hour])
+        {
+            before = hour;
+            continue;
+        }
+
+        auto after = hour + 1;
+        while(interpolated[after])
+            after++;
+
+        auto& previous = hours[before];
+        auto& next = hours[after];
+        auto& current = hours[hour];
+        auto weight = static_cast<double>(forecastHours[hour] - forecastHours[before]) / (forecastHours[after] - forecastHours[before]);
+
+        current.precipitationTypes = weight < 0.5 || next.precipitationTypes.empty() ? previous.precipitationTypes : next.precipitationTypes;
+        for(auto field = 0; field < GribFieldCount; field++)
+        {
+            current.stepStarts[field] = next.stepStarts[field];
+            auto interpolation = GetTemporalInterpolation(static_cast<GribField>(field));
+            if(IsCategoricalGribField(static_cast<GribField>(field)) || interpolation == TemporalInterpolation::DerivedInterpolation)
+                continue;
+
+            auto& from = previous.fields[field];
+            auto& to = next.fields[field];
+            if(from.empty() || to.empty())
+                continue;
+
+            auto startedOver = interpolation == TemporalInterpolation::BucketInterpolation && next.stepStarts[field] != previous.stepStarts[field];
+            if(startedOver && next.stepStarts[field] != forecastHours[before])
+                ERR_OUT("Hour " << forecastHours[hour] << " can't be filled in. Hour " << forecastHours[after] << "'s precipitation bucket starts at hour " 
+                    << next.stepStarts[field] << ", so part of what fell since hour " << forecastHours[before] << " isn't in either of them.");
+
+            auto& column = current.fields[field];
+            column.resize(numberOfPoints);
+
+            //Everything in to fell after the hour before the gap, so the hour in it gets its share.
+            if(startedOver)
+            {
+                #pragma omp parallel for simd
+                for(size_t i = 0; i < numberOfPoints; i++)
+                    column[i] = to[i] * weight;
+
+                continue;
+            }
+
+            #pragma omp parallel for simd
+            for(size_t i = 0; i < numberOfPoints; i++)
+                column[i] = from[i] + (to[i] - from[i]) * weight;
+        }
+    }
+}
\ No newline at end of file
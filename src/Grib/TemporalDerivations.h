@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Grib.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+//How a field is carried from one forecast hour to the next, one point at a time.
+enum TemporalScan : uint8_t
+{
+    //The target adds up every rise in the source since the first hour, like snowfall out of snow depth.
+    AccumulatedIncreaseScan,
+    //The target is how much the source grew since the hour before, or all of it when the source's bucket started over.
+    BucketDifferenceScan,
+    //The target never drops below any hour before it. Source is ignored.
+    MonotonicScan,
+    //The target adds up the source over every hour so far, like a total out of what fell each step.
+    RunningSumScan
+};
+
+struct TemporalDerivation
+{
+    GribField source, target;
+    TemporalScan scan;
+};
+
+//How an hour that wasn't downloaded is filled in from the hours on either side of it.
+enum TemporalInterpolation : uint8_t
+{
+    //By forecast hour. Running totals are interpolated the same way, which spreads whatever fell over the gap evenly across it.
+    LinearInterpolation,
+    //Left empty, for a TemporalDerivation to fill in, like new precipitation out of the totals.
+    DerivedInterpolation,
+    //Like a running total within one bucket. When the bucket after the gap started over at the hour before it, what fell since then is
+    //spread over the gap instead, and the hours in it start their buckets there too. Any other start can't be filled in.
+    BucketInterpolation
+};
+
+TemporalInterpolation GetTemporalInterpolation(GribField field);
+
+//Every field built out of the hours before it, in the order they run, so a derivation can build on one above it.
+//subHourly is for HRRR's 15 minute product, whose steps stand in for the hours.
+const std::vector<TemporalDerivation>& GetTemporalDerivations(WeatherModel weatherModel, bool subHourly = false);
+
+//Runs the model's derivations over hours, which must be in forecast order, each point on its own across every hour.
+//Points are split into blocks across the threads, so each thread walks the hours over a block small enough to stay in cache.
+void DeriveTemporalFields(WeatherModel weatherModel, std::vector<RawForecastHour>& hours, size_t numberOfPoints, bool subHourly = false);
+
+//Fills in every hour flagged in interpolated from the closest hours before and after it that aren't, which have to be there.
+//forecastHours and interpolated line up with hours. Precipitation types come from whichever side is closer.
+void InterpolateHours(std::vector<RawForecastHour>& hours, const std::vector<uint16_t>& forecastHours, const std::vector<uint8_t>& interpolated, size_t numberOfPoints);
\ No newline at end of file
@@ -4,35 +4,31 @@
 #include <stdlib.h>
 
 #include <chrono>
+#include <functional>
 #include <iostream>
+#include <string>
 #include <thread>
 
 #include <curl/curl.h>
 
 class HttpClient
 {
-    public:
-    inline static void Init() { curl_global_init(CURL_GLOBAL_DEFAULT); }
+    private:
+    static size_t AppendToString(char* data, size_t size, size_t count, void* userData)
+    {
+        static_cast<std::string*>(userData)->append(data, size * count);
+        return size * count;
+    }
 
-    template <typename fn>
-    static void Get(const char* url, fn callback, void* userData)
+    //Keeps trying on a 404, since NOAA puts files up a bit at a time. Anything else going wrong is fatal.
+    //resetSink throws away whatever the 404 wrote, its error page, so the next try's response starts out clean.
+    static long Perform(CURL* curl, const char* url, const std::function<void ()>& resetSink)
     {
         using namespace std;
-        auto curl = curl_easy_init();
-
-        if(!curl)
-        {
-            cout << "Unable to initalize curl" << endl;
-            exit(1);
-        }
-
+        long httpCode = 0;
         auto retryMultiplier = 1;
         while(true)
         {
-            long httpCode = 0;
-            curl_easy_setopt(curl, CURLOPT_URL, url);
-            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, callback);
-            curl_easy_setopt(curl, CURLOPT_WRITEDATA, userData);
             auto code = curl_easy_perform(curl);
 
             if(code != CURLE_OK)
@@ -48,9 +44,12 @@ class HttpClient
                 if(httpCode == 404)
                 {
                     cout << "Will try " << url << " again..." << endl;
-                    this_thread::sleep_for(10s * retryMultiplier);
+                    this_thread::sleep_for(retryDelay * retryMultiplier);
                     cout << "Re-downloading " << url << endl;
 
+                    if(resetSink)
+                        resetSink();
+
                     retryMultiplier = min(retryMultiplier + 1, 6);
 
                     continue;
@@ -62,6 +61,87 @@ class HttpClient
             break;
         }
 
+        return httpCode;
+    }
+
+    static CURL* Open(const char* url)
+    {
+        using namespace std;
+        auto curl = curl_easy_init();
+
+        if(!curl)
+        {
+            cout << "Unable to initalize curl" << endl;
+            exit(1);
+        }
+
+        curl_easy_setopt(curl, CURLOPT_URL, url);
+        return curl;
+    }
+
+    public:
+    //How long the first retry after a 404 waits, and each one after waits that much longer, up to 6 times as long.
+    inline static std::chrono::milliseconds retryDelay = std::chrono::seconds(10);
+
+    inline static void Init() { curl_global_init(CURL_GLOBAL_DEFAULT); }
+
+    //Just asks, and doesn't wait around on a 404 the way Get does, for finding out how far along NOAA is. Anything else going wrong is still fatal.
+    static bool Exists(const char* url)
+    {
+        using namespace std;
+        auto curl = Open(url);
+        curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+
+        auto code = curl_easy_perform(curl);
+        if(code != CURLE_OK)
+        {
+            cout << "Curl failed: " << code << endl;
+            exit(1);
+        }
+
+        long httpCode = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
+        curl_easy_cleanup(curl);
+
+        if(httpCode >= 300 && httpCode != 404)
+        {
+            cout << "Http request failed: " << httpCode << endl;
+            exit(1);
+        }
+
+        return httpCode < 300;
+    }
+
+    //resetSink is for starting userData over after a 404. Without one, the 404's page stays ahead of the real response.
+    template <typename fn>
+    static void Get(const char* url, fn callback, void* userData, const std::function<void ()>& resetSink = nullptr)
+    {
+        auto curl = Open(url);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, callback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, userData);
+        Perform(curl, url, resetSink);
+        curl_easy_cleanup(curl);
+    }
+
+    //Whole response in body, which is cleared first. With ranges (in curl's "0-99,200-299" form) expect a 206, and when there's more than one range,
+    //a multipart/byteranges body whose boundary is in contentType. Returns the HTTP status code.
+    static long Get(const char* url, std::string& body, const char* ranges = nullptr, std::string* contentType = nullptr)
+    {
+        body.clear();
+
+        auto curl = Open(url);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, AppendToString);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
+        if(ranges)
+            curl_easy_setopt(curl, CURLOPT_RANGE, ranges);
+
+        auto httpCode = Perform(curl, url, [&]() { body.clear(); });
+
+        char* responseContentType = nullptr;
+        if(contentType && curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &responseContentType) == CURLE_OK && responseContentType)
+            *contentType = responseContentType;
+
         curl_easy_cleanup(curl);
+        return httpCode;
     }
 };
\ No newline at end of file
@@ -6,7 +6,9 @@
 #include "Drawing/ForecastImages/RegionalForecast.h"
 #include "Drawing/ForecastImages/WeatherMaps.h"
 #include "Drawing/ImageCache.h"
+#include "Error.h"
 #include "Geography/Geo.h"
+#include "Grib/GribArchive.h"
 #include "Grib/GribDownloader.h"
 #include "Grib/GribReader.h"
 #include "NumberFormat.h"
@@ -20,6 +22,7 @@
 #include <fstream>
 #include <random>
 #include <sstream>
+#include <thread>
 
 extern "C" {
     #include "LocalForecastLib.h"
@@ -34,15 +37,40 @@ struct ForecastData {
     time_t forecastStart;
     WeatherModel weatherModel;
     uint16_t maxGribIndex, skipToGribNumber;
+    //More than one for an ensemble, the control's first.
+    vector<string> memberFileTemplates;
 };
 
 #define HasFlag(f, t) ((f & t) == f)
 
+static IngestOptions ingestOptions = {
+    .modes = IngestModes::DefaultIngestMode,
+    .downloadThreads = 3,
+    .decodeThreads = 0,
+    .queueCapacity = 8,
+    .tileRows = 1,
+    .tileColumns = 1,
+    .memoryBudgetMB = 1024,
+    .hrrrHourStrides = {{0, 2}},
+    .gfsHourStrides = {{0, 3}, {120, 6}},
+    .ensembleMembers = 30,
+    .blendFadeStartHour = 36,
+    .blendFadeEndHour = 48,
+    .blendLastHour = 120,
+    .archivedRuns = 8,
+    .archiveTemperatureStep = 0.1f,
+    .archivePrecipitationStep = 0.01f
+};
+
 class LocalForecastRunner
 {
 private:
     unique_ptr<IForecast> forecast;
     unique_ptr<GribData> gribData;
+    //Only when tiled or streamed, already holding (or having set aside) every frame's overlays.
+    unique_ptr<IWeatherMaps> incrementalWeatherMaps;
+    //Past 0 when hours were added on to a forecast whose earlier frames are already drawn.
+    int32_t firstNewForecastIndex = 0;
     
     WeatherModel weatherModel; //Is set in ProcessGribData.
     fs::path gribFilePath;
@@ -64,16 +92,110 @@ private:
             downloader.GetForecastStartTime(),
             downloader.GetWeatherModel(),
             downloader.GetMaxGribIndex(),
-            downloader.GetSkipToGribNumber()
+            downloader.GetSkipToGribNumber(),
+            downloader.GetMemberFilePathTemplates()
         };
     }
 
-    void ProcessGribData(const ForecastData& data, bool useCache)
+    static inline bool IsBlended(WeatherModel weatherModel) { return weatherModel == WeatherModel::HRRR && HasFlag(BlendedModelsIngestMode, ingestOptions.modes); }
+
+    static inline bool IsSubHourly(WeatherModel weatherModel) { return weatherModel == WeatherModel::HRRR && HasFlag(SubHourlyIngestMode, ingestOptions.modes); }
+
+    static inline bool IsTiled() { return ingestOptions.tileRows > 1 || ingestOptions.tileColumns > 1; }
+
+    static vector<ForecastHourStride> GetHourStrides(WeatherModel weatherModel)
+    {
+        vector<ForecastHourStride> hourStrides;
+        if(!HasFlag(SparseHoursIngestMode, ingestOptions.modes) || weatherModel == WeatherModel::GEFS)
+            return hourStrides;
+
+        auto bands = weatherModel == WeatherModel::GFS ? ingestOptions.gfsHourStrides : ingestOptions.hrrrHourStrides;
+        for(auto i = 0; i < MAX_HOUR_STRIDE_BANDS && bands[i].stride; i++)
+            hourStrides.push_back({ bands[i].fromHour, bands[i].stride });
+
+        return hourStrides;
+    }
+
+    IGribReader* AllocGribReaderForIngest(const ForecastData& data) { return AllocGribReaderForIngest(data, selectedRegion); }
+
+    IGribReader* AllocGribReaderForIngest(const ForecastData& data, const SelectedRegion& region)
+    {
+        auto readModes = HasFlag(MappedGribInputMode, ingestOptions.modes) ? GribReadModes::MappedGribReadMode : GribReadModes::DefaultGribReadMode;
+        if(HasFlag(NativeUnpackMode, ingestOptions.modes))
+            readModes = (GribReadModes)(readModes | GribReadModes::NativeUnpackGribReadMode);
+        if(HasFlag(ValidateNativeUnpackMode, ingestOptions.modes))
+            readModes = (GribReadModes)(readModes | GribReadModes::NativeUnpackGribReadMode | GribReadModes::ValidateUnpackGribReadMode);
+        if(HasFlag(SparseHoursIngestMode, ingestOptions.modes))
+            readModes = (GribReadModes)(readModes | GribReadModes::InterpolateMissingHoursGribReadMode);
+        if(IsSubHourly(data.weatherModel))
+            readModes = (GribReadModes)(readModes | GribReadModes::SubHourlyGribReadMode);
+
+        return AllocGribReader(data.gribFileTemplate, region, data.weatherModel, system_clock::from_time_t(data.forecastStart), data.skipToGribNumber, data.maxGribIndex, geoCalcs, readModes);
+    }
+
+    //There's never a whole region GribData, so there's no gribdata.bin either, and the weather maps are drawn a piece at a time as they go by.
+    void ProcessIncrementalGribData(const ForecastData& data, RenderTargets renderTargets)
+    {
+        this->weatherModel = data.weatherModel;
+        auto forecastKey = GetForecastKey(this->weatherModel);
+        auto forecastJsonPath = forecastFilePath / string("forecast.json");
+
+        if(!std::filesystem::exists(forecastFilePath))
+            std::filesystem::create_directories(forecastFilePath);
+
+        if(HasFlag(WeatherMapsRenderTarget, renderTargets))
+            incrementalWeatherMaps = unique_ptr<IWeatherMaps>(AllocWeatherMaps(forecast, gribData, geoCalcs, selectedRegion.GetMapBackgroundFileName()));
+
+        auto forecastRepo = unique_ptr<IForecastRepo>(InitForecastRepo(forecastKey));
+        unique_ptr<IGribReader> gribReader(AllocGribReaderForIngest(data));
+        if(HasFlag(StreamingIngestMode, ingestOptions.modes))
+        {
+            gribReader->CollectStreamedData(forecastRepo, static_cast<size_t>(ingestOptions.memoryBudgetMB) * 1024 * 1024, [&](unique_ptr<GribData>& hours, int32_t firstForecastIndex) {
+                if(incrementalWeatherMaps)
+                    incrementalWeatherMaps->DrawHours(hours, firstForecastIndex, forecastFilePath);
+            });
+        }
+        else
+        {
+            gribReader->CollectTiledData(forecastRepo, ingestOptions.tileRows, ingestOptions.tileColumns, [&](unique_ptr<GribData>& tile) {
+                if(incrementalWeatherMaps)
+                    incrementalWeatherMaps->DrawTile(tile, forecastFilePath);
+            });
+        }
+
+        cout << "Saving " << forecastFilePath << "..." << endl;
+        forecastRepo->Save(forecastJsonPath.c_str());
+
+        forecast = unique_ptr<IForecast>(forecastRepo->GetForecast());
+        forecast->SetNow(system_clock::to_time_t(system_clock::now()));
+    }
+
+    //Keeps a compressed copy of gribData for this run under archive/, when asked to, and drops the oldest past archivedRuns.
+    void ArchiveGribData(time_t forecastStart)
+    {
+        if(!HasFlag(ArchiveGribDataIngestMode, ingestOptions.modes) || !gribData)
+            return;
+
+        auto precision = GetDefaultGribArchivePrecision();
+        precision[GribField::TemperatureField] = precision[GribField::DewpointField] = ingestOptions.archiveTemperatureStep;
+        precision[GribField::TotalPrecipitationField] = precision[GribField::NewPrecipitationField] = ingestOptions.archivePrecipitationStep;
+
+        auto archiveDirectory = forecastFilePath / string("archive");
+        fs::create_directories(archiveDirectory);
+
+        auto archivePath = GetGribArchivePath(archiveDirectory, forecastStart);
+        cout << "Archiving " << archivePath << "..." << endl;
+        SaveGribArchive(archivePath, *gribData, precision);
+        RemoveOldGribArchives(archiveDirectory, ingestOptions.archivedRuns);
+    }
+
+    //With a laterReader, data's hours are blended into its on the way to the one GribData.
+    void ProcessGribData(const ForecastData& data, bool useCache, BoundedQueue<LandedGrib>* landedGribs = nullptr, IGribReader* laterReader = nullptr)
     {
         unique_ptr<IForecastRepo> forecastRepo;
 
         this->weatherModel = data.weatherModel;
-        auto forecastKey = this->weatherModel == WeatherModel::HRRR ? "hrrr" : "gfs";
+        auto forecastKey = GetForecastKey(this->weatherModel);
 
         auto gribDataPath = forecastFilePath / string("gribdata.bin");
         auto forecastJsonPath = forecastFilePath / string("forecast.json");        
@@ -84,22 +206,41 @@ private:
                 std::filesystem::create_directories(forecastFilePath);
 
             forecastRepo = unique_ptr<IForecastRepo>(InitForecastRepo(forecastKey));
-            unique_ptr<IGribReader> gribReader(AllocGribReader(data.gribFileTemplate, selectedRegion, data.weatherModel, system_clock::from_time_t(data.forecastStart), data.skipToGribNumber, data.maxGribIndex, geoCalcs));
-            gribReader->CollectData(forecastRepo, gribData);
+            unique_ptr<IGribReader> gribReader(AllocGribReaderForIngest(data));
+            if(laterReader)
+                gribReader->CollectBlendedData(forecastRepo, *laterReader, ingestOptions.blendFadeStartHour, ingestOptions.blendFadeEndHour, gribData);
+            else if(data.memberFileTemplates.size() > 1)
+                gribReader->CollectEnsembleData(forecastRepo, data.memberFileTemplates, gribData);
+            else if(landedGribs)
+                gribReader->CollectData(forecastRepo, gribData, *landedGribs, ingestOptions.decodeThreads);
+            else
+                gribReader->CollectData(forecastRepo, gribData);
 
             cout << "Saving " << forecastFilePath << "..." << endl;
             forecastRepo->Save(forecastJsonPath.c_str());
 
             cout << "Saving " << gribDataPath <<  "..." << endl;
             gribData->Save(gribDataPath);
+            ArchiveGribData(data.forecastStart);
         }
         else
         {
             cout << "Loading " << forecastJsonPath << "..." << endl;
             forecastRepo = unique_ptr<IForecastRepo>(LoadForecastRepo(forecastKey, forecastJsonPath.c_str()));
 
-            cout << "Loading " << gribDataPath << "..." << endl;
-            gribData = unique_ptr<GribData>(GribData::Load(gribDataPath));
+            //Weather maps are never drawn from the cache, and a tiled run doesn't leave one.
+            auto archivePath = GetGribArchivePath(forecastFilePath / string("archive"), data.forecastStart);
+            if(fs::exists(gribDataPath))
+            {
+                cout << "Loading " << gribDataPath << "..." << endl;
+                gribData = unique_ptr<GribData>(GribData::Load(gribDataPath));
+            }
+            else if(fs::exists(archivePath))
+            {
+                cout << "Loading " << archivePath << "..." << endl;
+                unique_ptr<GribArchiveReader> archiveReader(GribArchiveReader::Open(archivePath));
+                gribData = unique_ptr<GribData>(archiveReader->ReadAll());
+            }
         }
 
         forecast = unique_ptr<IForecast>(forecastRepo->GetForecast());
@@ -113,10 +254,12 @@ private:
         else
             cout << "Skipping regional forecast." << endl;
 
-        if(HasFlag(WeatherMapsRenderTarget, renderTargets))
+        if(HasFlag(WeatherMapsRenderTarget, renderTargets) && incrementalWeatherMaps)
+            incrementalWeatherMaps->FinishForecastMaps(forecastFilePath);
+        else if(HasFlag(WeatherMapsRenderTarget, renderTargets))
         {
             auto weatherMaps = unique_ptr<IWeatherMaps>(AllocWeatherMaps(forecast, gribData, geoCalcs, selectedRegion.GetMapBackgroundFileName()));
-            weatherMaps->GenerateForecastMaps(forecastFilePath);
+            weatherMaps->GenerateForecastMaps(forecastFilePath, firstNewForecastIndex);
         }
         else
             cout << "Skipping Weather Maps." << endl;
@@ -124,12 +267,12 @@ private:
         if(HasFlag(PersonalForecastsRenderTarget, renderTargets))
         {
             PersonalForecasts personalForecasts(forecast.get());
-            personalForecasts.RenderAll(forecastFilePath, weatherModel == WeatherModel::GFS ? INT32_MAX : 24);
+            personalForecasts.RenderAll(forecastFilePath, weatherModel != WeatherModel::HRRR || IsBlended(weatherModel) ? INT32_MAX : 24);
         }
 
-        if(weatherModel == WeatherModel::GFS)
+        if(weatherModel != WeatherModel::HRRR)
         {
-            cout << "Text forecast not supported yet for GFS." << endl;
+            cout << "Text forecast not supported yet for " << GetWeatherModelName(weatherModel) << "." << endl;
             return;
         }
 
@@ -173,9 +316,9 @@ private:
         if(!HasFlag(VideoRenderTarget, renderTargets))
             return;
 
-        if(weatherModel == WeatherModel::GFS)
+        if(weatherModel != WeatherModel::HRRR)
         {
-            cout << "Video not supported yet for GFS." << endl;
+            cout << "Video not supported yet for " << GetWeatherModelName(weatherModel) << "." << endl;
             return;
         }
 
@@ -192,9 +335,11 @@ private:
         for(auto& map : maps)
         {
             cout << "Rendering " << map << " frames..." << endl;
-            forecast->GetForecastsFromNow(now, UINT32_MAX, [&](system_clock::time_point& forecastTime, int32_t forecastIndex)
+            forecast->GetForecastsFromNow(now, UINT32_MAX, seconds(0), [&](system_clock::time_point& forecastTime, int32_t forecastIndex)
             {
-                encoder->EncodeImagesFittingPattern(forecastFilePath / (map + "-" + ToStringWithPad(3, '0', forecastIndex) + ".png"), 2, forecastFilePath / "bg.png");
+                //Sub-hourly steps get a frame each, so the animation runs smoother instead of four times as long.
+                auto frameDuration = forecast->GetForecastStepLength(forecastIndex) < secondsInHour ? 1 : 2;
+                encoder->EncodeImagesFittingPattern(forecastFilePath / (map + "-" + ToStringWithPad(3, '0', forecastIndex) + ".png"), frameDuration, forecastFilePath / "bg.png");
             });
         }
 
@@ -203,14 +348,27 @@ private:
 
     static inline string WeatherModelToFilePath(WeatherModel model)
     {
-        return model == WeatherModel::HRRR ? "hrrr" : "gfs";
+        switch(model)
+        {
+            case WeatherModel::HRRR:
+                return "hrrr";
+            case WeatherModel::GEFS:
+                return "gefs";
+            default:
+                return "gfs";
+        }
     }
 
+    static inline string GetGribFolder(WeatherModel model) { return IsSubHourly(model) ? "hrrr-subh" : WeatherModelToFilePath(model); }
+
+    //A blend still starts from the HRRR's GRIBs, but it's a forecast of its own.
+    static inline string GetForecastKey(WeatherModel model) { return IsBlended(model) ? "blend" : GetGribFolder(model); }
+
 public:
     LocalForecastRunner(WeatherModel weatherModel, const SelectedRegion& selectedRegion) :
         forecast(nullptr),
-        gribFilePath(fs::path("data") / WeatherModelToFilePath(weatherModel)),
-        forecastFilePath(fs::path("forecasts") / selectedRegion.GetOutputFolder() / WeatherModelToFilePath(weatherModel)),
+        gribFilePath(fs::path("data") / GetGribFolder(weatherModel)),
+        forecastFilePath(fs::path("forecasts") / selectedRegion.GetOutputFolder() / GetForecastKey(weatherModel)),
         weatherModel(weatherModel),
         selectedRegion(selectedRegion),
         geoCalcs(selectedRegion) 
@@ -235,9 +393,161 @@ public:
         ProcessGribData(data, true); 
     }
 
+    void ProcessPipelinedGribData(GribDownloader& downloader)
+    {
+        BoundedQueue<LandedGrib> landedGribs(ingestOptions.queueCapacity);
+        ForecastData data = ForecastDataFromDownloader(downloader);
+
+        //Enough for every download thread to be filling one while the queue is full.
+        GribBufferPool bufferPool(ingestOptions.queueCapacity + ingestOptions.downloadThreads);
+        auto inMemory = HasFlag(InMemoryIngestMode, ingestOptions.modes);
+
+        auto ingestStart = steady_clock::now();
+        thread downloadThread([&]() { 
+            if(inMemory)
+                downloader.Download(landedGribs, ingestOptions.downloadThreads, bufferPool, !HasFlag(NoGribArchiveMode, ingestOptions.modes));
+            else
+                downloader.Download(landedGribs, ingestOptions.downloadThreads); 
+        });
+        ProcessGribData(data, false, &landedGribs);
+        downloadThread.join();
+
+        auto stats = landedGribs.GetStats();
+        cout << "Pipelined ingest took " << ToStringWithPrecision(1, duration<double>(steady_clock::now() - ingestStart).count()) << "s: " 
+            << ingestOptions.downloadThreads << " download threads idle " << ToStringWithPrecision(1, stats.pushIdle.count()) << "s waiting on a full queue, "
+            << "decode threads idle " << ToStringWithPrecision(1, stats.popIdle.count()) << "s waiting on downloads, "
+            << "queue depth max " << stats.maxDepth << " mean " << ToStringWithPrecision(1, stats.MeanDepth()) << " of " << landedGribs.GetCapacity() << "." << endl;
+    }
+
+    //The GFS run is usually older than the HRRR's, so its hours are shifted by the difference, and it's picked up from the hour
+    //the fade starts on, so its totals have an hour to rise from. Its region is its own, which pads out far enough to cover the HRRR's points.
+    void ProcessBlendedGribData(GribDownloader& downloader, GribDownloadModes downloadModes)
+    {
+        downloader.Download();
+
+        SelectedRegion gfsRegion(WeatherModel::GFS, selectedRegion.GetKey());
+        auto lead = max<int32_t>(0, (downloader.GetForecastStartTime() - GetStartTimeForWeatherModelDownload(WeatherModel::GFS)) / secondsInHour);
+        auto gfsLastHour = min<int32_t>(384, ingestOptions.blendLastHour + lead);
+        GribDownloader gfsDownloader(gfsRegion, fs::path("data") / WeatherModelToFilePath(WeatherModel::GFS), WeatherModel::GFS, gfsLastHour, 
+            min<int32_t>(gfsLastHour, ingestOptions.blendFadeStartHour + lead), downloadModes, GetHourStrides(WeatherModel::GFS));
+        gfsDownloader.Download();
+
+        unique_ptr<IGribReader> gfsReader(AllocGribReaderForIngest(ForecastDataFromDownloader(gfsDownloader), gfsRegion));
+        ProcessGribData(ForecastDataFromDownloader(downloader), false, nullptr, gfsReader.get());
+    }
+
+    //The last run's hours are only picked up from if it was for the same forecast start time. Its last hour's GRIB is read again,
+    //so the totals carry on from where they were.
+    void ProcessAppendedGribData(uint16_t skipToGribNumber, uint16_t maxGribIndex, GribDownloadModes downloadModes)
+    {
+        if(weatherModel == WeatherModel::GEFS || IsTiled() || IsBlended(weatherModel) || IsSubHourly(weatherModel) 
+            || HasFlag(StreamingIngestMode, ingestOptions.modes) || HasFlag(SparseHoursIngestMode, ingestOptions.modes))
+            ERR_OUT("Only a whole HRRR or GFS run can have new hours added on to it, without tiles, streaming, blending, sparse or sub-hourly hours.");
+
+        auto forecastKey = GetForecastKey(weatherModel);
+        auto gribDataPath = forecastFilePath / string("gribdata.bin");
+        auto forecastJsonPath = forecastFilePath / string("forecast.json");
+        auto forecastStart = GetStartTimeForWeatherModelDownload(weatherModel);
+
+        unique_ptr<IForecastRepo> forecastRepo;
+        uint16_t lastHour = 0;
+        if(fs::exists(gribDataPath) && fs::exists(forecastJsonPath) && fs::exists(gribFilePath / string("downloadInfo.bin")) 
+            && GribDownloader(selectedRegion, gribFilePath).GetForecastStartTime() == forecastStart)
+        {
+            cout << "Loading " << forecastJsonPath << " to add on to..." << endl;
+            forecastRepo = unique_ptr<IForecastRepo>(LoadForecastRepo(forecastKey, forecastJsonPath.c_str()));
+            gribData = unique_ptr<GribData>(GribData::Load(gribDataPath));
+            firstNewForecastIndex = gribData->GetNumberOfFiles();
+
+            auto lastForecast = unique_ptr<IForecast>(forecastRepo->GetForecast());
+            lastHour = static_cast<uint16_t>((lastForecast->GetForecastTime(firstNewForecastIndex - 1) - forecastStart) / secondsInHour);
+            skipToGribNumber = lastHour + 1;
+        }
+
+        GribDownloader downloader(selectedRegion, gribFilePath, weatherModel, maxGribIndex, skipToGribNumber, downloadModes);
+        if(skipToGribNumber > maxGribIndex || !downloader.LimitToPublishedHours())
+        {
+            if(!forecastRepo)
+                ERR_OUT("Nothing to forecast from yet.");
+
+            cout << "No new hours to add on." << endl;
+            forecast = unique_ptr<IForecast>(forecastRepo->GetForecast());
+            forecast->SetNow(system_clock::to_time_t(system_clock::now()));
+            return;
+        }
+
+        downloader.Download();
+        auto data = ForecastDataFromDownloader(downloader);
+        if(!forecastRepo)
+        {
+            ProcessGribData(data, false);
+            return;
+        }
+
+        data.skipToGribNumber = lastHour;
+        unique_ptr<GribData> newHours;
+        unique_ptr<IGribReader> gribReader(AllocGribReaderForIngest(data));
+        gribReader->CollectAppendedData(forecastRepo, *gribData, newHours);
+        gribData = unique_ptr<GribData>(GribData::Append(*gribData, *newHours));
+
+        cout << "Saving " << forecastFilePath << "..." << endl;
+        forecastRepo->Save(forecastJsonPath.c_str());
+
+        cout << "Saving " << gribDataPath <<  "..." << endl;
+        gribData->Save(gribDataPath);
+        ArchiveGribData(forecastStart);
+
+        forecast = unique_ptr<IForecast>(forecastRepo->GetForecast());
+        forecast->SetNow(system_clock::to_time_t(system_clock::now()));
+    }
+
     void ProcessGribData(RenderTargets& renderTargets, uint16_t skipToGribNumber, uint16_t maxGribIndex) 
     {
-        GribDownloader downloader(selectedRegion, gribFilePath, weatherModel, maxGribIndex, skipToGribNumber);
+        auto downloadModes = HasFlag(ByteRangeDownloadMode, ingestOptions.modes) ? GribDownloadModes::ByteRangeGribDownloadMode : GribDownloadModes::DefaultGribDownloadMode;
+        if(IsSubHourly(weatherModel))
+        {
+            if(IsBlended(weatherModel) || HasFlag(StreamingIngestMode, ingestOptions.modes) || HasFlag(SparseHoursIngestMode, ingestOptions.modes))
+                ERR_OUT("Sub-hourly HRRR can't be blended, streamed or downloaded sparse.");
+
+            downloadModes = (GribDownloadModes)(downloadModes | GribDownloadModes::SubHourlyGribDownloadMode);
+        }
+
+        if(HasFlag(AppendNewHoursIngestMode, ingestOptions.modes))
+        {
+            ProcessAppendedGribData(skipToGribNumber, maxGribIndex, downloadModes);
+            return;
+        }
+
+        GribDownloader downloader(selectedRegion, gribFilePath, weatherModel, maxGribIndex, skipToGribNumber, downloadModes, GetHourStrides(weatherModel), ingestOptions.ensembleMembers);
+
+        //Every member is read an hour at a time already, so none of the other ingest modes apply.
+        if(weatherModel == WeatherModel::GEFS)
+        {
+            downloader.Download();
+            ProcessGribData(ForecastDataFromDownloader(downloader), false);
+            return;
+        }
+
+        //Both models have to be read in full before they can be regridded and blended, so this doesn't pipeline, tile or stream either.
+        if(IsBlended(weatherModel))
+        {
+            ProcessBlendedGribData(downloader, downloadModes);
+            return;
+        }
+
+        if(IsTiled() || HasFlag(StreamingIngestMode, ingestOptions.modes))
+        {
+            downloader.Download();
+            ProcessIncrementalGribData(ForecastDataFromDownloader(downloader), renderTargets);
+            return;
+        }
+
+        if((HasFlag(PipelinedIngestMode, ingestOptions.modes) || HasFlag(InMemoryIngestMode, ingestOptions.modes)) && !downloader.UseCacheIfCurrent())
+        {
+            ProcessPipelinedGribData(downloader);
+            return;
+        }
+
         downloader.Download();
         ForecastData data = ForecastDataFromDownloader(downloader);
         ProcessGribData(data, false); 
@@ -280,6 +590,14 @@ extern "C"
 {
     void LocalForecastLibInit() { InitInternal(); }
 
+    IngestOptions LocalForecastLibDefaultIngestOptions() { return ingestOptions; }
+
+    void LocalForecastLibSetIngestOptions(const IngestOptions* options) 
+    {
+        if(options)
+            ingestOptions = *options;
+    }
+
     void LocalForecastLibRenderRegionalForecast(const char* regionKey, char** pathToPngBuffer) 
     {
         fs::path pathToJson, pathToPng;
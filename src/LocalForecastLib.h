@@ -13,9 +13,69 @@ enum RenderTargets {
     AllRenderTargets = RegionalForecastRenderTarget | PersonalForecastsRenderTarget | WeatherMapsRenderTarget | TextForecastRenderTarget | VideoRenderTarget
 };
 
-enum WxModel{ NoModel, HRRRWxModel, GFSWxModel };
+enum WxModel{ NoModel, HRRRWxModel, GFSWxModel, GEFSWxModel };
+
+enum IngestModes {
+    DefaultIngestMode = 0,
+    PipelinedIngestMode = (1 << 0),
+    MappedGribInputMode = (1 << 1),
+    //Whole NOAA files cut down by their .idx, so the full grid comes back instead of just the region.
+    ByteRangeDownloadMode = (1 << 2),
+    //Pipelined, but each hour is decoded from the response still in memory. The GRIBs are still written to disk afterwards, off to the side,
+    //unless NoGribArchiveMode is set too, in which case there's nothing left on disk to render a cached forecast from.
+    InMemoryIngestMode = (1 << 3),
+    NoGribArchiveMode = (1 << 4),
+    NativeUnpackMode = (1 << 5),
+    //NativeUnpackMode, checked against eccodes on every message. Slower than either alone, it's for trying out new data.
+    ValidateNativeUnpackMode = (1 << 6),
+    //Reads, compiles, forecasts and draws the hours in order, a window at a time, holding no more than memoryBudgetMB of them at once.
+    //Like tiles, the GRIBs are read back off disk, and it's the one that's used if tiles are asked for too.
+    StreamingIngestMode = (1 << 7),
+    //Downloads only the hours picked out by the model's hour stride bands, and fills in the rest from the hours on either side.
+    SparseHoursIngestMode = (1 << 8),
+    //HRRRWxModel only. Runs on into the GFS past the HRRR's hours, cross-fading between the two, and renders the whole thing as one forecast.
+    BlendedModelsIngestMode = (1 << 9),
+    //HRRRWxModel only. HRRR's 15 minute sub-hourly product, for smoother map frames, with GRIBs and a forecast of its own under hrrr-subh.
+    //Files hold four steps each, so it can't be streamed, blended or downloaded sparse. Personal and text forecasts still go by the hour.
+    SubHourlyIngestMode = (1 << 10),
+    //For checking back on a run while NOAA is still putting it up. Downloads only the hours published since the last run of the same forecast,
+    //adds them on to its gribdata.bin and forecast.json, and draws only their map frames. With nothing to add on to, it starts over with
+    //whatever's up so far. HRRR and GFS only, and not with tiles or any of the modes above that change how the hours are read.
+    AppendNewHoursIngestMode = (1 << 11),
+    //Also keeps a compressed copy of each run's gribdata.bin under archive/ in its forecast directory, the newest archivedRuns of them.
+    //Lossy, down to the archive steps. A cached run falls back on the current run's archive when its gribdata.bin is gone.
+    ArchiveGribDataIngestMode = (1 << 12)
+};
+
+#define MAX_HOUR_STRIDE_BANDS 4
+
+//From fromHour on, every stride-th hour is downloaded, until the next band takes over. A stride of 0 ends the list.
+typedef struct {
+    uint16_t fromHour, stride;
+} HourStrideBand;
+
+typedef struct {
+    enum IngestModes modes;
+    //Stage sizes for PipelinedIngestMode. A decodeThreads of 0 uses every core.
+    uint16_t downloadThreads, decodeThreads, queueCapacity;
+    //More than one tile splits the region up, and ingests, forecasts and draws one tile at a time, so a region too big to hold
+    //for every hour at once still fits. Tiles read the GRIBs back off disk, so PipelinedIngestMode and InMemoryIngestMode are ignored.
+    uint16_t tileRows, tileColumns;
+    uint16_t memoryBudgetMB;
+    //For SparseHoursIngestMode. The first and last hours are always downloaded.
+    HourStrideBand hrrrHourStrides[MAX_HOUR_STRIDE_BANDS], gfsHourStrides[MAX_HOUR_STRIDE_BANDS];
+    //GEFSWxModel only, how many of the perturbed members to read along with the control. The other ingest modes don't apply to it.
+    uint16_t ensembleMembers;
+    //For BlendedModelsIngestMode, by hour of the HRRR run. All HRRR through blendFadeStartHour, all GFS from blendFadeEndHour up to blendLastHour.
+    uint16_t blendFadeStartHour, blendFadeEndHour, blendLastHour;
+    //For ArchiveGribDataIngestMode. Steps are what temperature and dewpoint (ºF), and total and new precipitation (inches), are rounded to.
+    uint16_t archivedRuns;
+    float archiveTemperatureStep, archivePrecipitationStep;
+} IngestOptions;
 
 void LocalForecastLibInit();
+IngestOptions LocalForecastLibDefaultIngestOptions();
+void LocalForecastLibSetIngestOptions(const IngestOptions* ingestOptions);
 void LocalForecastLibRenderRegionalForecast(const char* regionKey, char** pathToPngBuffer);
 void LocalForecastLibRenderLocalForecast(const char* regionKey, enum WxModel wxModel, enum RenderTargets renderTargets, uint16_t skipToGribNumber, uint16_t maxGribIndex, char** pathToVideoBuffer, char** pathToTextBuffer);
 void LocalForecastLibRenderCahcedLocalForecast(const char* regionKey, enum WxModel wxModel, enum RenderTargets renderTargets, char** pathToVideoBuffer, char** pathToTextBuffer);
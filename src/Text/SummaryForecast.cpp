@@ -175,7 +175,7 @@ public:
             index++;
         }
 
-        forecast->GetForecastsFromNow(now, maxRows, [&](system_clock::time_point& forecastTime, int32_t forecastIndex)
+        forecast->GetForecastsFromNow(now, maxRows, hours(1), [&](system_clock::time_point& forecastTime, int32_t forecastIndex)
         {
             lastDate = GetLongDateTime(forecastTime + 1h); //We want to the END of the resulting hour.
         });
@@ -3,6 +3,7 @@ extern "C"
     #include "LocalForecastLib.h"
 }
 
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
@@ -17,6 +18,7 @@ struct Options {
     string locationKey;
     WxModel wxModel;
     uint16_t maxGribIndex, skipToGribNumber;
+    IngestOptions ingestOptions;
 };
 
 inline bool NextICheck(int& i, int& argc)
@@ -37,9 +39,11 @@ Options GetOptionsFromArgs(int argc, const char* argv[])
         .renderTargets = RenderTargets::AllRenderTargets,
         .wxModel = WxModel::HRRRWxModel, 
         .maxGribIndex = 48, 
-        .skipToGribNumber = 1
+        .skipToGribNumber = 1,
+        .ingestOptions = LocalForecastLibDefaultIngestOptions()
     };
 
+    auto hrrrStridesGiven = false, gfsStridesGiven = false;
     for(auto i = 0; i < argc; i++)
     {
         if(OptIs("-useCache"))
@@ -61,6 +65,8 @@ Options GetOptionsFromArgs(int argc, const char* argv[])
                 opts.wxModel = WxModel::HRRRWxModel;
             else if(OptIs("GFS"))
                 opts.wxModel = WxModel::GFSWxModel;
+            else if(OptIs("GEFS"))
+                opts.wxModel = WxModel::GEFSWxModel;
             else   
             {
                 cout << "Unknown Model." << endl;
@@ -73,6 +79,103 @@ Options GetOptionsFromArgs(int argc, const char* argv[])
             opts.maxGribIndex = static_cast<uint16_t>(atoi(argv[++i]));
         else if(OptIs("-skipToGribNumber") && NextI())
             opts.skipToGribNumber = static_cast<uint16_t>(atoi(argv[++i]));
+        else if(OptIs("-pipeline"))
+            opts.ingestOptions.modes = (IngestModes)(opts.ingestOptions.modes | PipelinedIngestMode);
+        else if(OptIs("-mmap"))
+            opts.ingestOptions.modes = (IngestModes)(opts.ingestOptions.modes | MappedGribInputMode);
+        else if(OptIs("-byteRanges"))
+            opts.ingestOptions.modes = (IngestModes)(opts.ingestOptions.modes | ByteRangeDownloadMode);
+        else if(OptIs("-inMemory"))
+            opts.ingestOptions.modes = (IngestModes)(opts.ingestOptions.modes | InMemoryIngestMode);
+        else if(OptIs("-noArchive"))
+            opts.ingestOptions.modes = (IngestModes)(opts.ingestOptions.modes | NoGribArchiveMode);
+        else if(OptIs("-nativeUnpack"))
+            opts.ingestOptions.modes = (IngestModes)(opts.ingestOptions.modes | NativeUnpackMode);
+        else if(OptIs("-validateUnpack"))
+            opts.ingestOptions.modes = (IngestModes)(opts.ingestOptions.modes | ValidateNativeUnpackMode);
+        else if(OptIs("-downloadThreads") && NextI())
+            opts.ingestOptions.downloadThreads = static_cast<uint16_t>(atoi(argv[++i]));
+        else if(OptIs("-decodeThreads") && NextI())
+            opts.ingestOptions.decodeThreads = static_cast<uint16_t>(atoi(argv[++i]));
+        else if(OptIs("-queueCapacity") && NextI())
+            opts.ingestOptions.queueCapacity = static_cast<uint16_t>(atoi(argv[++i]));
+        else if(OptIs("-stream"))
+            opts.ingestOptions.modes = (IngestModes)(opts.ingestOptions.modes | StreamingIngestMode);
+        else if(OptIs("-memoryBudgetMB") && NextI())
+            opts.ingestOptions.memoryBudgetMB = static_cast<uint16_t>(atoi(argv[++i]));
+        else if(OptIs("-tileRows") && NextI())
+            opts.ingestOptions.tileRows = static_cast<uint16_t>(atoi(argv[++i]));
+        else if(OptIs("-tileColumns") && NextI())
+            opts.ingestOptions.tileColumns = static_cast<uint16_t>(atoi(argv[++i]));
+        else if(OptIs("-ensembleMembers") && NextI())
+            opts.ingestOptions.ensembleMembers = static_cast<uint16_t>(atoi(argv[++i]));
+        else if(OptIs("-subHourly"))
+            opts.ingestOptions.modes = (IngestModes)(opts.ingestOptions.modes | SubHourlyIngestMode);
+        else if(OptIs("-append"))
+            opts.ingestOptions.modes = (IngestModes)(opts.ingestOptions.modes | AppendNewHoursIngestMode);
+        else if(OptIs("-archiveGribData"))
+            opts.ingestOptions.modes = (IngestModes)(opts.ingestOptions.modes | ArchiveGribDataIngestMode);
+        else if(OptIs("-archivedRuns") && NextI())
+            opts.ingestOptions.archivedRuns = static_cast<uint16_t>(atoi(argv[++i]));
+        else if(OptIs("-archiveSteps") && NextI())
+        {
+            opts.ingestOptions.archiveTemperatureStep = static_cast<float>(atof(argv[++i]));
+            NextI();
+            opts.ingestOptions.archivePrecipitationStep = static_cast<float>(atof(argv[++i]));
+            if(!(opts.ingestOptions.archiveTemperatureStep > 0) || !(opts.ingestOptions.archivePrecipitationStep > 0))
+            {
+                cout << "Archive steps have to be more than 0." << endl;
+                exit(1);
+            }
+        }
+        else if(OptIs("-blend"))
+            opts.ingestOptions.modes = (IngestModes)(opts.ingestOptions.modes | BlendedModelsIngestMode);
+        else if(OptIs("-blendFade") && NextI())
+        {
+            opts.ingestOptions.blendFadeStartHour = static_cast<uint16_t>(atoi(argv[++i]));
+            NextI();
+            opts.ingestOptions.blendFadeEndHour = static_cast<uint16_t>(atoi(argv[++i]));
+        }
+        else if(OptIs("-blendLastHour") && NextI())
+            opts.ingestOptions.blendLastHour = static_cast<uint16_t>(atoi(argv[++i]));
+        else if(OptIs("-sparseHours"))
+            opts.ingestOptions.modes = (IngestModes)(opts.ingestOptions.modes | SparseHoursIngestMode);
+        else if(OptIs("-hourStride") && NextI())
+        {
+            i++;
+            auto isGFS = OptIs("GFS");
+            if(!isGFS && !OptIs("HRRR"))
+            {
+                cout << "Unknown Model." << endl;
+                exit(1);
+            }
+
+            NextI();
+            auto fromHour = static_cast<uint16_t>(atoi(argv[++i]));
+            NextI();
+            auto stride = static_cast<uint16_t>(atoi(argv[++i]));
+
+            //The first band given for a model replaces its defaults.
+            auto& clearedDefaults = isGFS ? gfsStridesGiven : hrrrStridesGiven;
+            auto bands = isGFS ? opts.ingestOptions.gfsHourStrides : opts.ingestOptions.hrrrHourStrides;
+            if(!clearedDefaults)
+            {
+                memset(bands, 0, sizeof(HourStrideBand) * MAX_HOUR_STRIDE_BANDS);
+                clearedDefaults = true;
+            }
+
+            auto band = 0;
+            while(band < MAX_HOUR_STRIDE_BANDS && bands[band].stride)
+                band++;
+
+            if(band == MAX_HOUR_STRIDE_BANDS)
+            {
+                cout << "Too many hour strides, only " << MAX_HOUR_STRIDE_BANDS << " per model." << endl;
+                exit(1);
+            }
+
+            bands[band] = { fromHour, stride };
+        }
     }
 
     return opts;
@@ -83,6 +186,7 @@ int main(int argc, const char* argv[])
 {   
     LocalForecastLibInit();    
     Options opts = GetOptionsFromArgs(argc, argv);
+    LocalForecastLibSetIngestOptions(&opts.ingestOptions);
     char* videoOutFile = nullptr, 
         * textOutFile = nullptr;
 
@@ -0,0 +1,369 @@
+#include "Error.h"
+#include "Grib/GribInventory.h"
+#include "HttpClient.h"
+#include "Test.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <map>
+#include <netinet/in.h>
+#include <sstream>
+#include <strings.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+enum class RangeSupport { Honors, Ignores };
+
+//A stand-in for NOMADS on 127.0.0.1, one request per connection. Serves files out of a map by path, with Range handled the way
+//an HTTP server would: a 206 for one range, a multipart/byteranges 206 for more, or, when it Ignores them, the whole file in a 200.
+class LocalHttpServer
+{
+private:
+    int listenFd = -1;
+    uint16_t port = 0;
+    atomic<bool> stopping = false;
+    thread serverThread;
+    map<string, string> files;
+    map<string, int> notFoundsLeft;
+    RangeSupport rangeSupport;
+
+    static string ReadRequest(int fd)
+    {
+        string request;
+        char buffer[4096];
+        while(request.find("\r\n\r\n") == string::npos)
+        {
+            auto count = recv(fd, buffer, sizeof(buffer), 0);
+            if(count <= 0)
+                break;
+
+            request.append(buffer, count);
+        }
+
+        return request;
+    }
+
+    static void SendAll(int fd, const string& response)
+    {
+        for(size_t sent = 0; sent < response.size();)
+        {
+            auto count = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if(count <= 0)
+                return;
+
+            sent += count;
+        }
+    }
+
+    static string Respond(const char* status, const string& headers, const string& body)
+    {
+        stringstream response;
+        response << "HTTP/1.1 " << status << "\r\nContent-Length: " << body.size() << "\r\nConnection: close\r\n" << headers << "\r\n" << body;
+        return response.str();
+    }
+
+    //"bytes=0-99,200-" into inclusive ranges, with the open ended one run out to the end of the file.
+    static vector<GribByteRange> ParseRanges(const string& value, size_t fileSize)
+    {
+        vector<GribByteRange> ranges;
+        stringstream stream(value.substr(value.find('=') + 1));
+        string range;
+        while(getline(stream, range, ','))
+        {
+            auto dash = range.find('-');
+            auto end = dash + 1 < range.size() ? stoll(range.substr(dash + 1)) : static_cast<int64_t>(fileSize) - 1;
+            ranges.push_back({ stoll(range.substr(0, dash)), end });
+        }
+
+        return ranges;
+    }
+
+    string Handle(const string& request)
+    {
+        auto pathStart = request.find(' ') + 1;
+        auto path = request.substr(pathStart, request.find(' ', pathStart) - pathStart);
+        requests.push_back(path);
+
+        auto file = files.find(path);
+        if(file == files.end())
+            return Respond("404 Not Found", "Content-Type: text/html\r\n", "<html><body>Not here</body></html>");
+
+        if(notFoundsLeft[path] > 0)
+        {
+            notFoundsLeft[path]--;
+            return Respond("404 Not Found", "Content-Type: text/html\r\n", "<html><body>Not published yet</body></html>");
+        }
+
+        string rangeValue;
+        stringstream lines(request);
+        string line;
+        while(getline(lines, line))
+        {
+            if(!line.empty() && line.back() == '\r')
+                line.pop_back();
+
+            if(!strncasecmp(line.c_str(), "Range:", 6))
+                rangeValue = line.substr(line.find_first_not_of(' ', 6));
+        }
+
+        auto& body = file->second;
+        if(rangeValue.empty() || rangeSupport == RangeSupport::Ignores)
+            return Respond("200 OK", "Content-Type: application/octet-stream\r\n", body);
+
+        rangeRequests.push_back(rangeValue);
+        auto ranges = ParseRanges(rangeValue, body.size());
+        if(ranges.size() == 1)
+        {
+            stringstream headers;
+            headers << "Content-Type: application/octet-stream\r\nContent-Range: bytes " << ranges[0].start << "-" << ranges[0].end << "/" << body.size() << "\r\n";
+            return Respond("206 Partial Content", headers.str(), body.substr(ranges[0].start, ranges[0].end - ranges[0].start + 1));
+        }
+
+        //Backwards, since the parts only should come back in the order they were asked for.
+        const string boundary = "LocalHttpServerBoundary";
+        stringstream multipart;
+        for(auto range = ranges.rbegin(); range != ranges.rend(); range++)
+        {
+            multipart << "\r\n--" << boundary << "\r\nContent-Type: application/octet-stream\r\nContent-Range: bytes "
+                << range->start << "-" << range->end << "/" << body.size() << "\r\n\r\n" << body.substr(range->start, range->end - range->start + 1);
+        }
+        multipart << "\r\n--" << boundary << "--\r\n";
+
+        return Respond("206 Partial Content", "Content-Type: multipart/byteranges; boundary=" + boundary + "\r\n", multipart.str());
+    }
+
+    void Serve()
+    {
+        while(true)
+        {
+            auto fd = accept(listenFd, nullptr, nullptr);
+            if(stopping)
+            {
+                if(fd >= 0)
+                    close(fd);
+                return;
+            }
+
+            if(fd < 0)
+                continue;
+
+            SendAll(fd, Handle(ReadRequest(fd)));
+            close(fd);
+        }
+    }
+
+public:
+    //Every path and Range header asked for, in order. Only read these once the server's stopped.
+    vector<string> requests, rangeRequests;
+
+    LocalHttpServer(RangeSupport rangeSupport) : rangeSupport(rangeSupport)
+    {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t addressLength = sizeof(address);
+
+        if(listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) || listen(listenFd, 8)
+            || getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &addressLength))
+            ERR_OUT("Unable to start the local HTTP server.");
+
+        port = ntohs(address.sin_port);
+    }
+
+    ~LocalHttpServer() 
+    { 
+        Stop();
+        close(listenFd);
+    }
+
+    void Add(const string& path, const string& body, int notFounds = 0)
+    {
+        files[path] = body;
+        notFoundsLeft[path] = notFounds;
+    }
+
+    void Start() { serverThread = thread(&LocalHttpServer::Serve, this); }
+
+    //Connects to itself so accept comes back and sees it's stopping.
+    void Stop()
+    {
+        if(!serverThread.joinable())
+            return;
+
+        stopping = true;
+        auto fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        close(fd);
+
+        serverThread.join();
+    }
+
+    string GetUrl(const string& path) const { return "http://127.0.0.1:" + to_string(port) + path; }
+};
+
+struct FakeMessage {
+    const char* variable;
+    const char* level;
+    size_t length;
+    bool wanted;
+};
+
+struct FakeGrib {
+    string file, inventory, wanted;
+};
+
+//Messages that are just GRIB, the variable name, filler, and 7777, with an HRRR style .idx for them, and what DownloadWantedMessages should keep.
+static FakeGrib MakeFakeGrib(const vector<FakeMessage>& messages)
+{
+    FakeGrib grib;
+    stringstream inventory;
+    for(size_t i = 0; i < messages.size(); i++)
+    {
+        inventory << (i + 1) << ":" << grib.file.size() << ":d=2024010100:" << messages[i].variable << ":" << messages[i].level << ":1 hour fcst:\n";
+
+        string message = string("GRIB") + messages[i].variable;
+        message.resize(messages[i].length - 4, static_cast<char>('a' + i));
+        message += "7777";
+
+        grib.file += message;
+        if(messages[i].wanted)
+            grib.wanted += message;
+    }
+
+    grib.inventory = inventory.str();
+    return grib;
+}
+
+//TMP, DPT and APCP are on hrrrInventoryFields, HGT and RH aren't.
+static const vector<FakeMessage> contiguousMessages = {
+    {"TMP", "2 m above ground", 1500, true}, {"DPT", "2 m above ground", 700, true}, {"HGT", "500 mb", 2100, false}, {"RH", "850 mb", 300, false}
+};
+
+static const vector<FakeMessage> scatteredMessages = {
+    {"HGT", "500 mb", 900, false}, {"TMP", "2 m above ground", 1500, true}, {"RH", "850 mb", 300, false}, {"DPT", "2 m above ground", 700, true},
+    {"HGT", "700 mb", 2100, false}, {"APCP", "surface", 1100, true}
+};
+
+static string Download(LocalHttpServer& server, const string& path, int32_t& totalMessages, int32_t& wantedMessages, size_t& rangeCount, ptrdiff_t maxRangesPerRequest = 32)
+{
+    string grib;
+    server.Start();
+    DownloadWantedMessages(server.GetUrl(path), WeatherModel::HRRR, grib, totalMessages, wantedMessages, rangeCount, maxRangesPerRequest);
+    server.Stop();
+    return grib;
+}
+
+static void TestSingleRange()
+{
+    auto fake = MakeFakeGrib(contiguousMessages);
+    LocalHttpServer server(RangeSupport::Honors);
+    server.Add("/hrrr.t00z.wrfsfcf01.grib2", fake.file);
+    server.Add("/hrrr.t00z.wrfsfcf01.grib2.idx", fake.inventory);
+
+    int32_t totalMessages = 0, wantedMessages = 0;
+    size_t rangeCount = 0;
+    auto grib = Download(server, "/hrrr.t00z.wrfsfcf01.grib2", totalMessages, wantedMessages, rangeCount);
+
+    CHECK(totalMessages == 4 && wantedMessages == 2, "Single range: expected 2 of 4 messages, got " << wantedMessages << " of " << totalMessages);
+    CHECK(rangeCount == 1, "Single range: neighbouring messages weren't merged, " << rangeCount << " ranges");
+    CHECK(server.rangeRequests.size() == 1 && server.rangeRequests[0] == "bytes=0-2199", "Single range: unexpected Range header");
+    CHECK(grib == fake.wanted, "Single range: downloaded " << grib.size() << " bytes that aren't the " << fake.wanted.size() << " wanted");
+}
+
+static void TestMultipartRanges()
+{
+    auto fake = MakeFakeGrib(scatteredMessages);
+    LocalHttpServer server(RangeSupport::Honors);
+    server.Add("/hrrr.t00z.wrfsfcf01.grib2", fake.file);
+    server.Add("/hrrr.t00z.wrfsfcf01.grib2.idx", fake.inventory);
+
+    int32_t totalMessages = 0, wantedMessages = 0;
+    size_t rangeCount = 0;
+    auto grib = Download(server, "/hrrr.t00z.wrfsfcf01.grib2", totalMessages, wantedMessages, rangeCount);
+
+    CHECK(totalMessages == 6 && wantedMessages == 3, "Multipart: expected 3 of 6 messages, got " << wantedMessages << " of " << totalMessages);
+    CHECK(rangeCount == 3, "Multipart: expected 3 ranges, got " << rangeCount);
+    CHECK(server.rangeRequests.size() == 1 && server.rangeRequests[0] == "bytes=900-2399,2700-3399,5500-", "Multipart: unexpected Range header");
+    CHECK(grib == fake.wanted, "Multipart: downloaded " << grib.size() << " bytes that aren't the " << fake.wanted.size() << " wanted");
+}
+
+static void TestRangesSplitAcrossRequests()
+{
+    auto fake = MakeFakeGrib(scatteredMessages);
+    LocalHttpServer server(RangeSupport::Honors);
+    server.Add("/hrrr.t00z.wrfsfcf01.grib2", fake.file);
+    server.Add("/hrrr.t00z.wrfsfcf01.grib2.idx", fake.inventory);
+
+    int32_t totalMessages = 0, wantedMessages = 0;
+    size_t rangeCount = 0;
+    auto grib = Download(server, "/hrrr.t00z.wrfsfcf01.grib2", totalMessages, wantedMessages, rangeCount, 2);
+
+    CHECK(server.rangeRequests.size() == 2, "Split ranges: expected 2 requests, got " << server.rangeRequests.size());
+    CHECK(grib == fake.wanted, "Split ranges: downloaded " << grib.size() << " bytes that aren't the " << fake.wanted.size() << " wanted");
+}
+
+static void TestServerIgnoringRanges()
+{
+    auto fake = MakeFakeGrib(scatteredMessages);
+    LocalHttpServer server(RangeSupport::Ignores);
+    server.Add("/hrrr.t00z.wrfsfcf01.grib2", fake.file);
+    server.Add("/hrrr.t00z.wrfsfcf01.grib2.idx", fake.inventory);
+
+    int32_t totalMessages = 0, wantedMessages = 0;
+    size_t rangeCount = 0;
+    auto grib = Download(server, "/hrrr.t00z.wrfsfcf01.grib2", totalMessages, wantedMessages, rangeCount);
+
+    CHECK(grib == fake.wanted, "Ignored ranges: kept " << grib.size() << " bytes that aren't the " << fake.wanted.size() << " wanted");
+}
+
+static void TestNotFoundThenPublished()
+{
+    auto fake = MakeFakeGrib(scatteredMessages);
+    LocalHttpServer server(RangeSupport::Honors);
+    server.Add("/hrrr.t00z.wrfsfcf01.grib2", fake.file, 1);
+    server.Add("/hrrr.t00z.wrfsfcf01.grib2.idx", fake.inventory, 1);
+
+    int32_t totalMessages = 0, wantedMessages = 0;
+    size_t rangeCount = 0;
+    auto grib = Download(server, "/hrrr.t00z.wrfsfcf01.grib2", totalMessages, wantedMessages, rangeCount);
+
+    CHECK(server.requests.size() == 4, "404 retry: expected each file to be asked for twice, " << server.requests.size() << " requests");
+    CHECK(totalMessages == 6 && wantedMessages == 3, "404 retry: the 404 page was read as part of the .idx");
+    CHECK(grib == fake.wanted, "404 retry: downloaded " << grib.size() << " bytes that aren't the " << fake.wanted.size() << " wanted");
+
+    //The same through the callback Get, the way whole files are saved, with the 404's page thrown out by resetSink.
+    LocalHttpServer fileServer(RangeSupport::Honors);
+    fileServer.Add("/gfs.t00z.pgrb2.0p25.f001", fake.file, 1);
+    fileServer.Start();
+
+    string body;
+    HttpClient::Get(fileServer.GetUrl("/gfs.t00z.pgrb2.0p25.f001").c_str(),
+        +[](char* data, size_t size, size_t count, void* userData) { static_cast<string*>(userData)->append(data, size * count); return size * count; },
+        &body, [&]() { body.clear(); });
+    fileServer.Stop();
+
+    CHECK(body == fake.file, "404 retry: the file saved after a 404 isn't the file, " << body.size() << " bytes");
+}
+
+int main()
+{
+    HttpClient::Init();
+    HttpClient::retryDelay = std::chrono::milliseconds(10);
+
+    TestSingleRange();
+    TestMultipartRanges();
+    TestRangesSplitAcrossRequests();
+    TestServerIgnoringRanges();
+    TestNotFoundThenPublished();
+
+    return TEST_RESULT;
+}
\ No newline at end of file
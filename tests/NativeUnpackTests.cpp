@@ -0,0 +1,208 @@
+#include "Error.h"
+#include "Grib/GribUnpacker.h"
+#include "Test.h"
+
+#include <cmath>
+#include <cstring>
+#include <eccodes.h>
+#include <filesystem>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+//Every packing GribUnpacker takes on, written by eccodes itself out of its GRIB2 sample. Spatial differencing is only ever order 1 or 2.
+struct Packing {
+    const char* packingType;
+    long orderOfSpatialDifferencing;
+};
+
+static const Packing packings[] = {
+    { "grid_simple", 0 },
+    { "grid_complex", 0 },
+    { "grid_complex_spatial_differencing", 1 },
+    { "grid_complex_spatial_differencing", 2 }
+};
+static const long bitsPerValues[] = { 12, 24 };
+
+enum class SampleField { Smooth, Constant };
+
+//Something like a temperature field, with negatives, or the same value everywhere, which packs down to 0 bits per value.
+//With missing, every 7th point and one whole run of them are missing, for the bitmap.
+static vector<double> MakeValues(size_t numberOfPoints, SampleField sampleField, bool missing, double missingValue)
+{
+    vector<double> values(numberOfPoints);
+    for(size_t i = 0; i < numberOfPoints; i++)
+    {
+        values[i] = sampleField == SampleField::Constant ? 273.15 : 260.0 + 25.0 * sin(i * 0.05) + 3.0 * cos(i * 0.31) - (i % 11) * 0.125;
+        if(missing && (i % 7 == 3 || (i >= numberOfPoints / 2 && i < numberOfPoints / 2 + 40)))
+            values[i] = missingValue;
+    }
+
+    return values;
+}
+
+//Packs values the way a model run would come in and hands back the encoded message, read in again as if from a file.
+static codes_handle* EncodeSample(const Packing& packing, long bitsPerValue, SampleField sampleField, bool missing, size_t& numberOfPoints)
+{
+    auto h = codes_grib_handle_new_from_samples(nullptr, "GRIB2");
+    if(!h)
+        ERR_OUT("Unable to load eccodes' GRIB2 sample.");
+
+    size_t packingTypeLength = strlen(packing.packingType);
+    CODES_CHECK(codes_set_string(h, "packingType", packing.packingType, &packingTypeLength), "Unable to set packingType");
+    if(packing.orderOfSpatialDifferencing)
+        CODES_CHECK(codes_set_long(h, "orderOfSpatialDifferencing", packing.orderOfSpatialDifferencing), "Unable to set orderOfSpatialDifferencing");
+
+    CODES_CHECK(codes_set_long(h, "bitsPerValue", bitsPerValue), "Unable to set bitsPerValue");
+
+    double missingValue = 9999;
+    if(missing)
+    {
+        CODES_CHECK(codes_set_double(h, "missingValue", missingValue), "Unable to set missingValue");
+        CODES_CHECK(codes_set_long(h, "bitmapPresent", 1), "Unable to set bitmapPresent");
+    }
+
+    CODES_CHECK(codes_get_size(h, "values", &numberOfPoints), "Unable to get the number of values");
+    auto values = MakeValues(numberOfPoints, sampleField, missing, missingValue);
+    CODES_CHECK(codes_set_double_array(h, "values", values.data(), values.size()), "Unable to set values");
+
+    const void* message = nullptr;
+    size_t messageLength = 0;
+    CODES_CHECK(codes_get_message(h, &message, &messageLength), "Unable to get message");
+
+    auto encoded = codes_handle_new_from_message_copy(nullptr, message, messageLength);
+    codes_handle_delete(h);
+    if(!encoded)
+        ERR_OUT("eccodes couldn't read back the message it wrote.");
+
+    return encoded;
+}
+
+//Every point, and then a region's worth of scattered ones, which simple packing reads straight out of the bit stream.
+static void MakeIndexes(size_t numberOfPoints, vector<int32_t>& everyPoint, vector<int32_t>& somePoints)
+{
+    everyPoint.resize(numberOfPoints);
+    for(size_t i = 0; i < numberOfPoints; i++)
+    {
+        everyPoint[i] = static_cast<int32_t>(i);
+        if(i % 3 == 1 || i % 17 == 0)
+            somePoints.push_back(static_cast<int32_t>(i));
+    }
+}
+
+//Has to agree with eccodes to the bit at every index, same as ValidateUnpackGribReadMode asks of real files.
+static void CompareWithEccodes(const string& name, codes_handle* h, size_t numberOfPoints, const vector<int32_t>& indexes)
+{
+    const void* message = nullptr;
+    size_t messageLength = 0, length = numberOfPoints;
+    double missingValue = 9999;
+    CODES_CHECK(codes_get_message(h, &message, &messageLength), "Unable to get message");
+    codes_get_double(h, "missingValue", &missingValue);
+
+    vector<double> expected(numberOfPoints), values(numberOfPoints, nan(""));
+    CODES_CHECK(codes_get_double_array(h, "values", expected.data(), &length), "Unable to get values");
+
+    auto unpacked = UnpackGribValues(static_cast<const uint8_t*>(message), messageLength, indexes.data(), indexes.size(), missingValue, values.data());
+    CHECK(unpacked, name << ": native unpack turned the message down");
+    if(!unpacked)
+        return;
+
+    auto differences = 0;
+    for(auto index : indexes)
+    {
+        if(!memcmp(&values[index], &expected[index], sizeof(double)))
+            continue;
+
+        if(differences++ < 5)
+            CHECK(false, name << ": differs from eccodes at grid point " << index << ": " << setprecision(17) << values[index] << " vs " << expected[index]);
+    }
+
+    CHECK(!differences, name << ": " << differences << " of " << indexes.size() << " points differ from eccodes");
+}
+
+//Real messages cut out of HRRR and GFS runs by fetch_unpack_fixtures.sh. Whatever is in fixtureDirectory is checked message by message,
+//and between them they have to include a 5.3 order 2 field and a bitmapped one, since those are what the samples above can't vouch for.
+//With no fixtures at all, this is reported and skipped rather than failed, so the test still runs without them.
+static void CompareFixtures(const fs::path& fixtureDirectory)
+{
+    vector<fs::path> fixtures;
+    error_code ec;
+    for(auto& entry : fs::directory_iterator(fixtureDirectory, ec))
+    {
+        if(entry.path().extension() == ".grib2")
+            fixtures.push_back(entry.path());
+    }
+
+    if(fixtures.empty())
+    {
+        cout << "No fixtures in " << fixtureDirectory << ", run tests/fetch_unpack_fixtures.sh to check real HRRR and GFS messages." << endl;
+        return;
+    }
+
+    auto secondOrderMessages = 0, bitmappedMessages = 0;
+    for(auto& fixture : fixtures)
+    {
+        auto f = fopen(fixture.c_str(), "rb");
+        if(!f)
+            ERR_OUT("Unable to open " << fixture);
+
+        int err = 0;
+        codes_handle* h = nullptr;
+        for(auto messageNumber = 1; (h = codes_handle_new_from_file(nullptr, f, PRODUCT_GRIB, &err)) != nullptr; messageNumber++)
+        {
+            long templateNumber = 0, order = 0, bitmapPresent = 0;
+            codes_get_long(h, "dataRepresentationTemplateNumber", &templateNumber);
+            codes_get_long(h, "orderOfSpatialDifferencing", &order);
+            codes_get_long(h, "bitmapPresent", &bitmapPresent);
+            secondOrderMessages += templateNumber == 3 && order == 2;
+            bitmappedMessages += bitmapPresent != 0;
+
+            size_t numberOfPoints = 0;
+            CODES_CHECK(codes_get_size(h, "values", &numberOfPoints), "Unable to get the number of values");
+
+            vector<int32_t> everyPoint, somePoints;
+            MakeIndexes(numberOfPoints, everyPoint, somePoints);
+
+            auto name = fixture.filename().string() + " message " + to_string(messageNumber) + " (5." + to_string(templateNumber) + (bitmapPresent ? ", bitmap" : "") + ")";
+            CompareWithEccodes(name, h, numberOfPoints, everyPoint);
+            CompareWithEccodes(name + ", some points", h, numberOfPoints, somePoints);
+            codes_handle_delete(h);
+        }
+
+        fclose(f);
+        CHECK(!err, fixture << ": eccodes stopped reading it: " << codes_get_error_message(err));
+    }
+
+    CHECK(secondOrderMessages, "None of the fixtures in " << fixtureDirectory << " is complex packing with order 2 spatial differencing.");
+    CHECK(bitmappedMessages, "None of the fixtures in " << fixtureDirectory << " has a bitmap.");
+}
+
+//Takes the fixture directory as its one argument, see CompareFixtures.
+int main(int argc, const char* argv[])
+{
+    for(auto& packing : packings)
+    for(auto bitsPerValue : bitsPerValues)
+    for(auto sampleField : { SampleField::Smooth, SampleField::Constant })
+    for(auto missing : { false, true })
+    {
+        size_t numberOfPoints = 0;
+        auto h = EncodeSample(packing, bitsPerValue, sampleField, missing, numberOfPoints);
+        auto name = string(packing.packingType) + (packing.orderOfSpatialDifferencing ? " order " + to_string(packing.orderOfSpatialDifferencing) : "")
+            + ", " + to_string(bitsPerValue) + " bits" + (sampleField == SampleField::Constant ? ", constant" : "") + (missing ? ", bitmap" : "");
+
+        vector<int32_t> everyPoint, somePoints;
+        MakeIndexes(numberOfPoints, everyPoint, somePoints);
+
+        CompareWithEccodes(name, h, numberOfPoints, everyPoint);
+        CompareWithEccodes(name + ", some points", h, numberOfPoints, somePoints);
+        codes_handle_delete(h);
+    }
+
+    if(argc > 1)
+        CompareFixtures(argv[1]);
+
+    return TEST_RESULT;
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <iostream>
+
+//Just enough to run a handful of checks from main and have ctest see the result. Every failure is printed, and main returns TEST_RESULT.
+inline int testFailures = 0;
+
+#define CHECK(condition, streamCommands) {\
+    if(!(condition)) {\
+        std::cerr << __FILE__ << ":" << __LINE__ << ": " << streamCommands << std::endl; \
+        testFailures++;\
+    }\
+}
+
+#define TEST_RESULT (testFailures ? 1 : 0)
\ No newline at end of file
@@ -0,0 +1,32 @@
+#!/bin/bash
+#Cuts the messages native-unpack-tests checks against eccodes out of one HRRR and one GFS run on NOAA's AWS buckets,
+#a byte range per message off the .idx, into tests/fixtures. Both models pack these as 5.3 with order 2 spatial differencing,
+#and GFS's soil moisture is only over land, so it comes with a bitmap.
+set -e
+
+fixtures="$(dirname "$0")/fixtures"
+run=20240601
+hrrr="https://noaa-hrrr-bdp-pds.s3.amazonaws.com/hrrr.$run/conus/hrrr.t00z.wrfsfcf01.grib2"
+gfs="https://noaa-gfs-bdp-pds.s3.amazonaws.com/gfs.$run/00/atmos/gfs.t00z.pgrb2.0p25.f003"
+
+#The message runs up to the byte before the next one in the .idx, or to the end of the file when it's the last.
+fetch() {
+    local url=$1 match=$2 output=$3
+    local range=$(curl -sf "$url.idx" | awk -F: -v match_="$match" '
+        found && !done { print start "-" ($2 - 1); done = 1 }
+        !found && index($0, match_) { start = $2; found = 1 }
+        END { if(found && !done) print start "-" }')
+
+    if [ -z "$range" ]; then
+        echo "No $match in $url.idx"
+        exit 1
+    fi
+
+    curl -sf -r "$range" "$url" -o "$fixtures/$output"
+    echo "$output: $match, bytes $range"
+}
+
+mkdir -p "$fixtures"
+fetch "$hrrr" ":TMP:2 m above ground:" hrrr-tmp-2m.grib2
+fetch "$gfs" ":TMP:2 m above ground:" gfs-tmp-2m.grib2
+fetch "$gfs" ":SOILW:0-0.1 m below ground:" gfs-soilw-bitmap.grib2